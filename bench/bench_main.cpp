@@ -0,0 +1,736 @@
+// bench_main.cpp: Timing benchmarks for the unit converter
+// Usage: uc_bench [--json <file>] [--baseline <file>] [--tolerance <percent>] [--filter <prefix>]
+//                 [--uc <uc-binary>] [batch-input-file]
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <spawn.h>
+#include <sys/wait.h>
+
+// Include the library and command line to benchmark
+#include "cli.hpp"
+#include "history.hpp"
+#include "libuc.hpp"
+#include "unix_socket.hpp"
+
+
+// Keeps the optimiser from discarding benchmarked results
+static volatile double sink;
+
+
+// One measured figure. Names are dotted, section first, and stable across runs, since
+// baselines are matched by name.
+struct Measurement {
+    std::string name;
+    double value;
+    std::string unit;
+    bool higherIsBetter;
+};
+
+static std::vector<Measurement> measurements;
+
+// Only sections whose names start with this prefix are run
+static std::string filter;
+
+
+static bool selected(std::string_view section) {
+    return section.starts_with(filter) || filter.starts_with(section);
+}
+
+static void report(std::string name, double value, std::string unit, bool higherIsBetter) {
+    std::cout << std::format("{:<36}{:>14.2f} {}\n", name, value, unit);
+    measurements.push_back({ std::move(name), value, std::move(unit), higherIsBetter });
+}
+
+static void section(std::string_view title) {
+    std::cout << '\n' << title << '\n';
+}
+
+// Seconds taken by f
+template <typename F>
+static double seconds(F&& f) {
+    auto start = std::chrono::steady_clock::now();
+    f();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+
+// Builds a fixed-width unit table of n DISTANCE units, laid out like listOfUnits
+static std::string syntheticUnits(std::size_t n) {
+    std::string table;
+    for (std::size_t i = 0; i < n; ++i) {
+        table += std::format("{:<12}{:<20}{:<8}{:<15}{}\n", "DISTANCE", std::format("Unit {}", i),
+                             std::format("u{}", i), "Meter", 1.0 + static_cast<double>(i));
+    }
+    table.pop_back();
+    return table;
+}
+
+
+// Runs `uc args...` to completion with its output discarded and HOME in a scratch
+// directory, so the user's history is left alone
+static void runUc(const char* ucBinary, std::vector<std::string> args, const std::string& home) {
+    std::vector<char*> argv { const_cast<char*>(ucBinary) };
+    for (std::string& arg: args)
+        argv.push_back(arg.data());
+    argv.push_back(nullptr);
+    std::string homeVariable = "HOME=" + home;
+    char* envp[] = { homeVariable.data(), nullptr };
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+    pid_t child;
+    if (posix_spawn(&child, ucBinary, &actions, nullptr, argv.data(), envp) == 0)
+        waitpid(child, nullptr, 0);
+    posix_spawn_file_actions_destroy(&actions);
+}
+
+
+// Microseconds per run of the uc binary, printing its version and converting once
+static void benchStartup(const char* ucBinary, const std::filesystem::path& scratch) {
+    if (!std::filesystem::exists(ucBinary)) {
+        std::cout << std::format("{:<36}{:>14}\n", "startup", "-");
+        return;
+    }
+    const std::size_t runs = 200;
+    runUc(ucBinary, { "-v" }, scratch);
+    report("startup.version", seconds([&]() {
+        for (std::size_t i = 0; i < runs; ++i)
+            runUc(ucBinary, { "-v" }, scratch);
+    }) / runs * 1e6, "us", false);
+    report("startup.convert", seconds([&]() {
+        for (std::size_t i = 0; i < runs; ++i)
+            runUc(ucBinary, { std::to_string(i), "km", "mi" }, scratch);
+    }) / runs * 1e6, "us", false);
+}
+
+
+// Nanoseconds to load the builtin tables in place, and microseconds to parse them from text
+static void benchLoad() {
+    const std::size_t loads = 1000000, parses = 2000;
+    report("load.units.builtin", seconds([]() {
+        for (std::size_t i = 0; i < loads; ++i) {
+            Units u;
+            u.loadUnits(builtinUnits, builtinFactors);
+            sink = static_cast<double>(u.units().size());
+        }
+    }) / loads * 1e9, "ns", false);
+    report("load.constants.builtin", seconds([]() {
+        for (std::size_t i = 0; i < loads; ++i) {
+            Constants c;
+            c.loadConstants(builtinConstants);
+            sink = static_cast<double>(c.constants().size());
+        }
+    }) / loads * 1e9, "ns", false);
+    report("load.units.text", seconds([]() {
+        for (std::size_t i = 0; i < parses; ++i) {
+            Units u;
+            u.loadUnits(listOfUnits);
+            sink = static_cast<double>(u.units().size());
+        }
+    }) / parses * 1e6, "us", false);
+    report("load.constants.text", seconds([]() {
+        for (std::size_t i = 0; i < parses; ++i) {
+            Constants c;
+            c.loadConstants(listOfConstants);
+            sink = static_cast<double>(c.constants().size());
+        }
+    }) / parses * 1e6, "us", false);
+}
+
+
+// Nanoseconds per conversion and constant lookup through the library, by symbol and by
+// name, for a linear and an affine (temperature) pair, and through cached expression plans
+static void benchConvert() {
+    const std::size_t calls = 5000000;
+    Units u;
+    Constants c;
+    u.loadUnits(builtinUnits, builtinFactors);
+    c.loadConstants(builtinConstants);
+
+    auto convert = [&](const char* name, std::string_view from, std::string_view to) {
+        report(name, seconds([&]() {
+            for (std::size_t i = 0; i < calls; ++i)
+                sink = u.convert(static_cast<double>(i & 1023), from, to).value_or(0);
+        }) / calls * 1e9, "ns", false);
+    };
+    convert("convert.linear.symbol", "km", "mi");
+    convert("convert.linear.name", "Kilometer", "Mile");
+    convert("convert.temperature.symbol", "C", "F");
+    convert("convert.temperature.name", "Celsius", "Fahrenheit");
+    convert("convert.expression.cached", "kg*m/s^2", "g*cm/s^2");
+
+    auto constant = [&](const char* name, std::string_view input) {
+        report(name, seconds([&]() {
+            for (std::size_t i = 0; i < calls; ++i)
+                sink = c.value(input).value_or(0);
+        }) / calls * 1e9, "ns", false);
+    };
+    constant("constant.symbol", "NA");
+    constant("constant.name", "Speed of Light in Vacuum");
+}
+
+
+// Nanoseconds to compile a formula over constants and to evaluate compiled formulas, with
+// and without the input
+static void benchFormula() {
+    const std::size_t calls = 5000000;
+    Units u;
+    Constants c;
+    u.loadUnits(builtinUnits, builtinFactors);
+    c.loadConstants(builtinConstants);
+
+    report("formula.compile", seconds([&]() {
+        for (std::size_t i = 0; i < calls / 10; ++i)
+            sink = compileFormula(u, c, "2*pi*Speed of Light in Vacuum/x").instructions().size();
+    }) / (calls / 10) * 1e9, "ns", false);
+    auto evaluate = [&](const char* name, std::string_view text) {
+        Formula formula = compileFormula(u, c, text);
+        report(name, seconds([&]() {
+            double sum = 0;
+            for (std::size_t i = 0; i < calls; ++i)
+                sum += formula.evaluate(static_cast<double>(i & 1023));
+            sink = sum;
+        }) / calls * 1e9, "ns", false);
+    };
+    evaluate("formula.evaluate.constant", "NA*kB*(1 + 2^0.5)");
+    evaluate("formula.evaluate.input", "2*pi*c/x + x^2");
+}
+
+
+// Nanoseconds per convert call with and without a memo, over a few hundred distinct
+// repeated conversions, on one thread and on one per core
+static void benchMemo() {
+    const std::size_t calls = 2000000;
+    Units u;
+    u.loadUnits(builtinUnits, builtinFactors);
+    const char* pairs[][2] = { { "km", "mi" }, { "Celsius", "Fahrenheit" }, { "kg", "lb" }, { "GiB", "MB" } };
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+
+    auto time = [&](std::size_t memo, unsigned threadCount) {
+        u.memoize(memo);
+        return seconds([&]() {
+            std::vector<std::thread> running;
+            for (unsigned t = 0; t < threadCount; ++t) {
+                running.emplace_back([&]() {
+                    double sum = 0;
+                    for (std::size_t i = 0; i < calls; ++i) {
+                        auto [from, to] = pairs[i & 3];
+                        sum += u.convert(static_cast<double>(i % 250), from, to).value_or(0);
+                    }
+                    sink = sum;
+                });
+            }
+            for (std::thread& thread: running)
+                thread.join();
+        }) / calls * 1e9;
+    };
+    report("memo.convert.off", time(0, 1), "ns", false);
+    report("memo.convert.on", time(4096, 1), "ns", false);
+    report("memo.convert.parallel.off", time(0, threads), "ns", false);
+    report("memo.convert.parallel.on", time(4096, threads), "ns", false);
+}
+
+
+// Nanoseconds per convertValue call for random symbol and name lookups in a table of n units
+static void benchLookup(std::size_t n) {
+    const std::size_t calls = 1000000;
+    std::string table = syntheticUnits(n);
+    Units u;
+    u.loadUnits(table);
+
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<std::size_t> pick(0, n - 1);
+    std::vector<std::string> symbols, names;
+    for (std::size_t i = 0; i < 1024; ++i) {
+        symbols.push_back(std::format("u{}", pick(rng)));
+        names.push_back(std::format("UNIT {}", pick(rng)));
+    }
+
+    auto time = [&](const std::vector<std::string>& keys) {
+        return seconds([&]() {
+            for (std::size_t i = 0; i < calls; ++i)
+                sink = u.convertValue(1.0, keys[i % keys.size()], keys[(i + 1) % keys.size()]);
+        }) / calls * 1e9;
+    };
+
+    report(std::format("lookup.{}.symbol", n), time(symbols), "ns", false);
+    report(std::format("lookup.{}.name", n), time(names), "ns", false);
+}
+
+
+// Microseconds per append to a history of `entries` entries, one conversion at a time,
+// as one batch of 1000, and through a background writer
+static void benchHistory(const std::filesystem::path& scratch) {
+    const std::size_t entries = 1000000, appends = 2000;
+    const std::filesystem::path path = scratch / ".uc_history";
+    {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        std::string text;
+        for (std::size_t i = 1; i <= entries; ++i)
+            std::format_to(std::back_inserter(text), "{:<4} uc {} km mi {:g}\n", i, i % 1000, static_cast<double>(i % 1000) * 0.621371);
+        file << text;
+    }
+
+    History history(path);
+    // Builds the index, which later appends keep up to date
+    report("history.index", seconds([&]() { history.append(1, "km", "mi", 0.621371); }) * 1e3, "ms", false);
+    report("history.append", seconds([&]() {
+        for (std::size_t i = 0; i < appends; ++i)
+            history.append(static_cast<double>(i), "km", "mi", static_cast<double>(i) * 0.621371);
+    }) / appends * 1e6, "us", false);
+
+    std::string records;
+    for (std::size_t i = 0; i < 1000; ++i)
+        History::record(records, static_cast<double>(i), "km", "mi", static_cast<double>(i) * 0.621371);
+    const std::size_t batches = 50;
+    report("history.append.batch", seconds([&]() {
+        for (std::size_t i = 0; i < batches; ++i)
+            history.append(records);
+    }) / (batches * 1000) * 1e6, "us", false);
+
+    // Time the caller waits per append with a background writer, and until all are written
+    history.writeBehind();
+    double queued = 0;
+    report("history.append.behind", seconds([&]() {
+        queued = seconds([&]() {
+            for (std::size_t i = 0; i < appends; ++i)
+                history.append(static_cast<double>(i), "km", "mi", static_cast<double>(i) * 0.621371);
+        });
+        history.flush();
+    }) / appends * 1e6, "us", false);
+    report("history.append.behind.caller", queued / appends * 1e6, "us", false);
+    history.writeBehind(0);
+}
+
+
+// Millions of values per second converted one call at a time and with convertSpan
+static void benchConvertSpan(const std::string& from, const std::string& to) {
+    const std::size_t n = 1 << 20;
+    const int rounds = 20;
+    Units u;
+    u.loadUnits(builtinUnits, builtinFactors);
+    std::vector<double> in(n), out(n);
+    for (std::size_t i = 0; i < n; ++i)
+        in[i] = static_cast<double>(i % 1000);
+
+    double perCall = seconds([&]() {
+        for (std::size_t i = 0; i < n; ++i)
+            out[i] = u.convertValue(in[i], from, to);
+    });
+
+    UnitId fromId = u.findUnit(from), toId = u.findUnit(to);
+    double span = seconds([&]() {
+        for (int round = 0; round < rounds; ++round)
+            u.convertSpan(in, out, fromId, toId);
+    });
+    sink = out[n / 2];
+
+    report(std::format("span.{}-{}.convertValue", from, to), static_cast<double>(n) / perCall / 1e6, "Mvalues/s", true);
+    report(std::format("span.{}-{}.convertSpan", from, to), static_cast<double>(n) * rounds / span / 1e6, "Mvalues/s", true);
+}
+
+
+// Millions of results written per second, one per line, through stream manipulators as
+// uc once did and through an OutputBuffer in each style
+static void benchFormat() {
+    const std::size_t n = 2000000;
+    std::vector<double> values(n);
+    for (std::size_t i = 0; i < n; ++i)
+        values[i] = static_cast<double>(i) * 0.3048 + 0.125;
+
+    auto measure = [&](const char* name, auto&& write) {
+        std::ostringstream out;
+        report(name, static_cast<double>(n) / seconds([&]() { write(out); }) / 1e6, "Mvalues/s", true);
+        sink = static_cast<double>(out.tellp());
+    };
+    measure("format.iostream", [&](std::ostream& out) {
+        for (double value: values)
+            out << std::fixed << std::setprecision(4) << value << '\n';
+    });
+    for (auto [name, style]: { std::pair{ "format.fixed", NumberStyle::Fixed },
+                               std::pair{ "format.scientific", NumberStyle::Scientific },
+                               std::pair{ "format.shortest", NumberStyle::Shortest } }) {
+        measure(name, [&](std::ostream& out) {
+            OutputBuffer buffered(out, { style, 4 });
+            for (double value: values)
+                buffered << value << '\n';
+        });
+    }
+}
+
+
+// Microseconds to index a table of n units for search, and per completion and "did you
+// mean" suggestion for a short symbol and a long name, each one edit from a unit
+static void benchSearch(std::size_t n) {
+    const std::size_t calls = 2000;
+    std::string table = syntheticUnits(n);
+    Units u;
+    u.loadUnits(table);
+
+    std::optional<SearchIndex> index;
+    report(std::format("search.{}.index", n), seconds([&]() { index.emplace(u); }) * 1e6, "us", false);
+
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<std::size_t> pick(0, n - 1);
+    std::vector<std::string> symbols, names, prefixes;
+    for (std::size_t i = 0; i < 64; ++i) {
+        symbols.push_back(std::format("u{}x", pick(rng)));
+        names.push_back(std::format("Unit {}x", pick(rng)));
+        prefixes.push_back(std::format("Unit {}", pick(rng) / 10));
+    }
+
+    auto time = [&](const std::vector<std::string>& words, auto&& search) {
+        return seconds([&]() {
+            for (std::size_t i = 0; i < calls; ++i)
+                sink = static_cast<double>(search(words[i % words.size()]).size());
+        }) / calls * 1e6;
+    };
+    report(std::format("search.{}.suggest.symbol", n),
+           time(symbols, [&](const std::string& w) { return index->suggest(w, SearchKind::Unit); }), "us", false);
+    report(std::format("search.{}.suggest.name", n),
+           time(names, [&](const std::string& w) { return index->suggest(w, SearchKind::Unit); }), "us", false);
+    report(std::format("search.{}.complete", n),
+           time(prefixes, [&](const std::string& w) { return index->complete(w, SearchKind::Unit, 20); }), "us", false);
+}
+
+
+// Nanoseconds per conversion of whole amounts in double, long double and exact
+// arithmetic, and the largest error of the first two against the exact result in units
+// in the last place of a double. A double result is off by up to half a unit from its
+// rounding alone.
+static void benchPrecision(std::string_view from, std::string_view to) {
+    const std::int64_t n = 1000000;
+    Units u;
+    u.loadUnits(builtinUnits, builtinFactors);
+
+    long double doubleError = 0, extendedError = 0;
+    for (std::int64_t i = 1; i <= n; i += 997) {
+        long double exact = toLongDouble(*u.convertExact({ i, 1 }, from, to));
+        long double ulp = std::fabs(exact) * std::numeric_limits<double>::epsilon();
+        doubleError = std::max(doubleError, std::fabs(*u.convert(static_cast<double>(i), from, to) - exact) / ulp);
+        extendedError = std::max(extendedError, std::fabs(*u.convertExtended(static_cast<long double>(i), from, to) - exact) / ulp);
+    }
+
+    double inDouble = seconds([&]() {
+        for (std::int64_t i = 0; i < n; ++i)
+            sink = u.convert(static_cast<double>(i), from, to).value_or(0);
+    });
+    double inExtended = seconds([&]() {
+        for (std::int64_t i = 0; i < n; ++i)
+            sink = static_cast<double>(u.convertExtended(static_cast<long double>(i), from, to).value_or(0));
+    });
+    double inExact = seconds([&]() {
+        for (std::int64_t i = 0; i < n; ++i)
+            sink = static_cast<double>(u.convertExact({ i, 1 }, from, to).value_or(Rational()).num);
+    });
+
+    report(std::format("precision.{}-{}.double", from, to), inDouble / n * 1e9, "ns", false);
+    report(std::format("precision.{}-{}.extended", from, to), inExtended / n * 1e9, "ns", false);
+    report(std::format("precision.{}-{}.exact", from, to), inExact / n * 1e9, "ns", false);
+    report(std::format("precision.{}-{}.double.error", from, to), static_cast<double>(doubleError), "ulp", false);
+    report(std::format("precision.{}-{}.extended.error", from, to), static_cast<double>(extendedError), "ulp", false);
+}
+
+
+// Batch throughput with 1 to N jobs, on a file given on the command line or on 64 MiB
+// of generated `<value> <from> <to>` lines
+static void benchBatchScaling(const char* inputPath) {
+    std::string generated;
+    if (inputPath == nullptr) {
+        const char* pairs[] = { "m ft", "C F", "kg lb", "GiB MB" };
+        for (std::size_t i = 0; generated.size() < (64u << 20); ++i)
+            generated += std::format("{}.{} {}\n", i % 100000, i % 7, pairs[i % 4]);
+    }
+
+    Units u;
+    u.loadUnits(builtinUnits, builtinFactors);
+    std::ofstream discard("/dev/null");
+    unsigned maxJobs = std::max(1u, std::thread::hardware_concurrency());
+    double megabytes = static_cast<double>(inputPath != nullptr ? std::filesystem::file_size(inputPath) : generated.size()) / (1 << 20);
+
+    for (unsigned jobs = 1; jobs <= maxJobs; jobs *= 2) {
+        std::ifstream file;
+        std::istringstream memory;
+        if (inputPath != nullptr)
+            file.open(inputPath, std::ios::binary);
+        else
+            memory.str(generated);
+        std::istream& in = inputPath != nullptr ? static_cast<std::istream&>(file) : memory;
+
+        double elapsed = seconds([&]() { convertBatch(in, discard, u, "", "", jobs); });
+        // Job counts beyond one depend on the machine, so only the first is a stable name
+        report(jobs == 1 ? std::string("batch.jobs1") : std::format("batch.jobs{}", jobs), megabytes / elapsed, "MiB/s", true);
+        if (jobs < maxJobs && jobs * 2 > maxJobs)
+            jobs = maxJobs / 2;
+    }
+}
+
+
+// CSV column conversion on 64 MiB of generated rows, converting one and three of eight
+// columns, with a quoted field in every row
+static void benchCsv() {
+    std::string generated;
+    for (std::size_t i = 0; generated.size() < (64u << 20); ++i)
+        generated += std::format("{},\"Station {}, NO\",{}.{},{}.5,{},{}.25,ok,{}\n", i, i % 1000, i % 100000, i % 7,
+                                 i % 40, i % 3, i % 1013, i % 9);
+    double megabytes = static_cast<double>(generated.size()) / (1 << 20);
+
+    Units u;
+    u.loadUnits(builtinUnits, builtinFactors);
+    std::ofstream discard("/dev/null");
+    auto time = [&](std::string_view name, std::initializer_list<std::string_view> specs) {
+        std::vector<CsvColumn> columns;
+        for (std::string_view spec: specs)
+            columns.push_back(parseCsvColumn(u, spec));
+        CsvConverter converter(std::move(columns));
+        std::istringstream in(generated);
+        report(std::format("csv.{}", name), megabytes / seconds([&]() { convertCsv(in, discard, converter); }), "MiB/s", true);
+    };
+    time("columns1", { "3:ft:m" });
+    time("columns3", { "3:ft:m", "4:F:C", "6:mi:km" });
+}
+
+
+// Latency of conversions answered by a `uc --serve` daemon, one request at a time and
+// pipelined
+static void benchServer() {
+    Units u;
+    Constants c;
+    u.loadUnits(builtinUnits, builtinFactors);
+    c.loadConstants(builtinConstants);
+
+    std::string path = (std::filesystem::temp_directory_path() / std::format("uc_bench_{}.sock", getpid())).string();
+    UnixServer server(path);
+    std::thread serving([&]() {
+        server.run([&](std::string_view request, std::string& response) { return serveRequest(request, u, c, response); });
+    });
+
+    {
+        UnixClient client(path);
+        std::string response;
+        const std::size_t requests = 20000;
+        report("daemon.request", seconds([&]() {
+            for (std::size_t i = 0; i < requests; ++i)
+                client.request(std::format("{} km mi", i % 1000), response);
+        }) / requests * 1e6, "us", false);
+
+        std::string pipelined;
+        const std::size_t batch = 1000000;
+        for (std::size_t i = 0; i < batch; ++i)
+            pipelined += std::format("{} km mi\n", i % 1000);
+        report("daemon.pipelined", seconds([&]() {
+            client.exchange(pipelined, [](bool ok, std::string_view payload) { sink = ok ? static_cast<double>(payload.size()) : 0; });
+        }) / batch * 1e6, "us", false);
+    }
+    server.stop();
+    serving.join();
+}
+
+
+static std::string jsonString(std::string_view text) {
+    std::string quoted = "\"";
+    for (char ch: text) {
+        if (ch == '"' || ch == '\\')
+            quoted += '\\';
+        quoted += ch;
+    }
+    return quoted + '"';
+}
+
+// Writes the measurements as {"benchmarks": [{"name", "value", "unit", "better"}, ...]}
+static void writeJson(const std::string& path) {
+    std::ofstream out(path, std::ios::trunc);
+    if (!out)
+        throw std::runtime_error("Unable to write " + path);
+    out << "{\n  \"benchmarks\": [\n";
+    for (const Measurement& m: measurements) {
+        out << "    {\"name\": " << jsonString(m.name) << ", \"value\": " << std::format("{}", m.value)
+            << ", \"unit\": " << jsonString(m.unit) << ", \"better\": \"" << (m.higherIsBetter ? "higher" : "lower")
+            << "\"}" << (&m == &measurements.back() ? "" : ",") << '\n';
+    }
+    out << "  ]\n}\n";
+}
+
+// Reads the name and value of every benchmark of a file written by writeJson. Only that
+// layout is understood, not JSON in general.
+static std::vector<std::pair<std::string, double>> readJson(const std::string& path) {
+    std::ifstream in(path);
+    if (!in)
+        throw std::runtime_error("Unable to read " + path);
+    std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    std::vector<std::pair<std::string, double>> baseline;
+    const std::string_view nameKey = "\"name\": \"", valueKey = "\"value\": ";
+    for (std::size_t at = text.find(nameKey); at != std::string::npos; at = text.find(nameKey, at)) {
+        at += nameKey.size();
+        std::string name;
+        for (; at < text.size() && text[at] != '"'; ++at) {
+            if (text[at] == '\\' && at + 1 < text.size())
+                ++at;
+            name += text[at];
+        }
+        std::size_t value = text.find(valueKey, at);
+        if (value == std::string::npos)
+            break;
+        value += valueKey.size();
+        double number;
+        if (std::from_chars(text.data() + value, text.data() + text.size(), number).ec == std::errc())
+            baseline.emplace_back(std::move(name), number);
+    }
+    return baseline;
+}
+
+// Prints each measurement against its baseline and returns how many got worse by more
+// than tolerance percent
+static std::size_t compare(const std::string& baselinePath, double tolerance) {
+    auto baseline = readJson(baselinePath);
+    std::size_t regressions = 0;
+
+    section(std::format("Against {} (tolerance {}%)", baselinePath, tolerance));
+    std::cout << std::format("{:<36}{:>14}{:>14}{:>10}\n", "benchmark", "baseline", "current", "change");
+    for (const Measurement& m: measurements) {
+        auto match = std::find_if(baseline.begin(), baseline.end(), [&](const auto& entry) { return entry.first == m.name; });
+        if (match == baseline.end() || match->second <= 0)
+            continue;
+        double change = (m.value - match->second) / match->second * 100;
+        bool worse = m.higherIsBetter ? change < -tolerance : change > tolerance;
+        regressions += worse;
+        std::cout << std::format("{:<36}{:>14.2f}{:>14.2f}{:>+9.1f}%{}\n", m.name, match->second, m.value, change,
+                                 worse ? "  REGRESSION" : "");
+    }
+    return regressions;
+}
+
+
+int main(int argc, char* argv[]) {
+    std::optional<std::string> jsonPath, baselinePath;
+    double tolerance = 10;
+    const char* ucBinary = "bin/uc";
+    const char* batchInput = nullptr;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--json" && hasValue)
+            jsonPath = argv[++i];
+        else if (arg == "--baseline" && hasValue)
+            baselinePath = argv[++i];
+        else if (arg == "--tolerance" && hasValue)
+            tolerance = std::atof(argv[++i]);
+        else if (arg == "--filter" && hasValue)
+            filter = argv[++i];
+        else if (arg == "--uc" && hasValue)
+            ucBinary = argv[++i];
+        else if (!arg.starts_with("--") && batchInput == nullptr)
+            batchInput = argv[i];
+        else {
+            std::cerr << "Usage: uc_bench [--json <file>] [--baseline <file>] [--tolerance <percent>] "
+                         "[--filter <prefix>] [--uc <uc-binary>] [batch-input-file]\n";
+            return 2;
+        }
+    }
+
+    const std::filesystem::path scratch = std::filesystem::temp_directory_path() / std::format("uc_bench_{}", getpid());
+    std::filesystem::create_directories(scratch);
+
+    try {
+        if (selected("startup")) {
+            section("Process start-up (us/run)");
+            benchStartup(ucBinary, scratch);
+        }
+        if (selected("load")) {
+            section("Table loading");
+            benchLoad();
+        }
+        if (selected("convert") || selected("constant")) {
+            section("Single conversions and constants (ns/call)");
+            benchConvert();
+        }
+        if (selected("formula")) {
+            section("Formulas over constants (ns/call)");
+            benchFormula();
+        }
+        if (selected("memo")) {
+            section("Memoized conversions (ns/call)");
+            benchMemo();
+        }
+        if (selected("lookup")) {
+            section("convertValue lookup cost by table size (ns/call)");
+            for (std::size_t n: { 64, 256, 1024, 4096, 16384 })
+                benchLookup(n);
+        }
+        if (selected("search")) {
+            section("Unit search by table size (us)");
+            for (std::size_t n: { 64, 1024, 16384 })
+                benchSearch(n);
+        }
+        if (selected("history")) {
+            section("History on a 1M-entry file");
+            benchHistory(scratch);
+        }
+        if (selected("span")) {
+            section("Array conversion (Mvalues/s)");
+            benchConvertSpan("km", "mi");
+            benchConvertSpan("C", "F");
+        }
+        if (selected("format")) {
+            section("Result formatting (Mvalues/s)");
+            benchFormat();
+        }
+        if (selected("precision")) {
+            section("Precision against throughput (ns/call, ulp)");
+            benchPrecision("mi", "km");
+            benchPrecision("GiB", "KiB");
+        }
+        if (selected("batch")) {
+            section("Batch throughput (MiB/s)");
+            benchBatchScaling(batchInput);
+        }
+        if (selected("csv")) {
+            section("CSV columns (MiB/s)");
+            benchCsv();
+        }
+        if (selected("daemon")) {
+            section("Daemon requests (us/request)");
+            benchServer();
+        }
+    } catch (const std::exception& e) {
+        std::filesystem::remove_all(scratch);
+        std::cerr << "Error: " << e.what() << '\n';
+        return 2;
+    }
+    std::filesystem::remove_all(scratch);
+
+    try {
+        if (jsonPath)
+            writeJson(*jsonPath);
+        if (baselinePath && compare(*baselinePath, tolerance) > 0)
+            return 1;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << '\n';
+        return 2;
+    }
+    return 0;
+}
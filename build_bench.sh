@@ -0,0 +1,43 @@
+#!/bin/sh
+
+# Enable xtrace and errexit modes
+set -xe
+
+# Source code directory
+SRC_DIR="src"
+
+# Header directory
+HEADER_DIR="headers"
+
+# Benchmark directory
+BENCH_DIR="bench"
+
+# Output directory
+OUTPUT_DIR="bin"
+
+# Output executable name
+OUTPUT_EXECUTABLE="uc_bench"
+
+# Compiler command
+CC="g++ -std=c++23"
+
+# Compilation options (CFLAGS)
+CFLAGS="-Wall -Wextra -O3 -pthread"
+
+# Timings for --stats, compiled in with UC_STATS=1 ./build_main.sh
+if [ "${UC_STATS:-0}" = "1" ]; then
+    CFLAGS="$CFLAGS -DUC_STATS=1"
+fi
+
+# Include path for header files
+INCLUDE_PATH="-I$HEADER_DIR"
+
+# Benchmark files, and the sources they measure
+BENCH_FILES="$BENCH_DIR/bench_main.cpp"
+SOURCE_FILES="$SRC_DIR/constants.cpp $SRC_DIR/conversions.cpp $SRC_DIR/batch.cpp $SRC_DIR/catalogue.cpp $SRC_DIR/expressions.cpp $SRC_DIR/search.cpp $SRC_DIR/csv.cpp $SRC_DIR/formula.cpp $SRC_DIR/cli.cpp"
+
+# Create the output directory if it doesn't exist
+mkdir -p $OUTPUT_DIR
+
+# Compile and link the benchmark files
+$CC $CFLAGS $INCLUDE_PATH $SOURCE_FILES $BENCH_FILES -o $OUTPUT_DIR/$OUTPUT_EXECUTABLE
@@ -0,0 +1,61 @@
+#!/bin/sh
+
+# Enable xtrace and errexit modes
+set -xe
+
+# Source code directory
+SRC_DIR="src"
+
+# Header directory
+HEADER_DIR="headers"
+
+# Output directory
+OUTPUT_DIR="bin"
+
+# Object directory
+OBJECT_DIR="$OUTPUT_DIR/obj"
+
+# Library name
+LIBRARY="uc"
+
+# Compiler command
+CC="g++ -std=c++23"
+
+# Compilation options (CFLAGS)
+CFLAGS="-Wpedantic -Wall -Wextra -Wconversion -O3 -pthread -fPIC"
+
+# Timings for --stats, compiled in with UC_STATS=1 ./build_main.sh
+if [ "${UC_STATS:-0}" = "1" ]; then
+    CFLAGS="$CFLAGS -DUC_STATS=1"
+fi
+
+# Include path for header files
+INCLUDE_PATH="-I$HEADER_DIR"
+
+# Library source files
+LIBRARY_FILES="$SRC_DIR/conversions.cpp $SRC_DIR/constants.cpp $SRC_DIR/batch.cpp $SRC_DIR/catalogue.cpp $SRC_DIR/expressions.cpp $SRC_DIR/search.cpp $SRC_DIR/csv.cpp $SRC_DIR/formula.cpp"
+
+# Shared libraries are .dylib on macOS and .so elsewhere
+if [ "$(uname)" = "Darwin" ]; then
+    SHARED="lib$LIBRARY.dylib"
+    SHARED_FLAGS="-dynamiclib -install_name @rpath/$SHARED"
+else
+    SHARED="lib$LIBRARY.so"
+    SHARED_FLAGS="-shared"
+fi
+
+# Create the output directories if they don't exist
+mkdir -p $OUTPUT_DIR $OBJECT_DIR
+
+# Compile each source file once for both libraries
+OBJECTS=""
+for FILE in $LIBRARY_FILES; do
+    OBJECT="$OBJECT_DIR/$(basename "$FILE" .cpp).o"
+    $CC $CFLAGS $INCLUDE_PATH -c "$FILE" -o "$OBJECT"
+    OBJECTS="$OBJECTS $OBJECT"
+done
+
+# Archive the static library and link the shared one
+rm -f $OUTPUT_DIR/lib$LIBRARY.a
+ar rcs $OUTPUT_DIR/lib$LIBRARY.a $OBJECTS
+$CC $CFLAGS $SHARED_FLAGS $OBJECTS -o $OUTPUT_DIR/$SHARED
@@ -16,19 +16,27 @@ OUTPUT_DIR="bin"
 OUTPUT_EXECUTABLE="uc"
 
 # Compiler command
-CC="g++ -std=c++20"
+CC="g++ -std=c++23"
 
 # Compilation options (CFLAGS)
-CFLAGS="-Wpedantic -Wall -Wextra -Wconversion -O3"
+CFLAGS="-Wpedantic -Wall -Wextra -Wconversion -O3 -pthread"
+
+# Timings for --stats, compiled in with UC_STATS=1 ./build_main.sh
+if [ "${UC_STATS:-0}" = "1" ]; then
+    CFLAGS="$CFLAGS -DUC_STATS=1"
+fi
 
 # Include path for header files
 INCLUDE_PATH="-I$HEADER_DIR"
 
-# List of source files
-SOURCE_FILES="$SRC_DIR/main.cpp"
+# List of source files; the rest of uc is linked from libuc
+SOURCE_FILES="$SRC_DIR/main.cpp $SRC_DIR/cli.cpp"
 
 # Create the output directory if it doesn't exist
 mkdir -p $OUTPUT_DIR
 
-# Compile and link the source files
-$CC $CFLAGS $INCLUDE_PATH $SOURCE_FILES -o $OUTPUT_DIR/$OUTPUT_EXECUTABLE
+# Build libuc
+./build_lib.sh
+
+# Compile the source files and link them with the static library
+$CC $CFLAGS $INCLUDE_PATH $SOURCE_FILES $OUTPUT_DIR/libuc.a -o $OUTPUT_DIR/$OUTPUT_EXECUTABLE
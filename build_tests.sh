@@ -24,11 +24,16 @@ OUTPUT_DIR="bin"
 OUTPUT_EXECUTABLE="uc_tests"
 
 # Compiler command
-CC="g++ -std=c++20"
+CC="g++ -std=c++23"
 
 # Compilation options (CFLAGS)
 CFLAGS="-Wall -Wextra -O2"
 
+# Timings for --stats, compiled in with UC_STATS=1 ./build_main.sh
+if [ "${UC_STATS:-0}" = "1" ]; then
+    CFLAGS="$CFLAGS -DUC_STATS=1"
+fi
+
 # Include paths for header files and Google Test
 INCLUDE_PATH="-I$HEADER_DIR -I$GTEST_INCLUDE_DIR"
 
@@ -39,7 +44,7 @@ LIBRARY_PATH="-L$GTEST_LIB_DIR"
 GTEST_LIBS="-lgtest -lgtest_main -pthread"
 
 # List of source files (excluding the main file)
-# SOURCE_FILES="$SRC_DIR/constants.cpp $SRC_DIR/conversions.cpp $SRC_DIR/utilities.cpp"
+SOURCE_FILES="$SRC_DIR/constants.cpp $SRC_DIR/conversions.cpp $SRC_DIR/batch.cpp $SRC_DIR/catalogue.cpp $SRC_DIR/expressions.cpp $SRC_DIR/search.cpp $SRC_DIR/csv.cpp $SRC_DIR/formula.cpp $SRC_DIR/cli.cpp"
 
 # Test files
 TEST_FILES="$TEST_DIR/test_main.cpp"
@@ -48,5 +53,4 @@ TEST_FILES="$TEST_DIR/test_main.cpp"
 mkdir -p $OUTPUT_DIR
 
 # Compile and link the source files, test files, and Google Test libraries
-# $CC $CFLAGS $INCLUDE_PATH $LIBRARY_PATH $SOURCE_FILES $TEST_FILES $GTEST_LIBS -o $OUTPUT_DIR/$OUTPUT_EXECUTABLE
-$CC $CFLAGS $INCLUDE_PATH $LIBRARY_PATH $TEST_FILES $GTEST_LIBS -o $OUTPUT_DIR/$OUTPUT_EXECUTABLE
+$CC $CFLAGS $INCLUDE_PATH $LIBRARY_PATH $SOURCE_FILES $TEST_FILES $GTEST_LIBS -o $OUTPUT_DIR/$OUTPUT_EXECUTABLE
@@ -0,0 +1,57 @@
+# uc.bash: Bash completion for uc. Source it from ~/.bashrc, or install it as
+# /etc/bash_completion.d/uc.
+# Unit, category, constant and group names come from `uc --complete`, so units loaded
+# from UC_UNITS_PATH are completed too.
+
+_uc_complete() {
+    local cur=${COMP_WORDS[COMP_CWORD]}
+    local prev=${COMP_WORDS[COMP_CWORD - 1]}
+    local kind
+
+    case $prev in
+        --units-file|--constants-file|--batch-file|--serve|--client)
+            COMPREPLY=($(compgen -f -- "$cur"))
+            return ;;
+        -u) kind=categories ;;
+        -C) kind=groups ;;
+        --complete)
+            COMPREPLY=($(compgen -W "units categories constants groups" -- "$cur"))
+            return ;;
+        --col) return ;;
+        --history-mode)
+            COMPREPLY=($(compgen -W "async drop sync" -- "$cur"))
+            return ;;
+    esac
+
+    if [ "$COMP_CWORD" -gt 1 ] && [ "${COMP_WORDS[1]}" = --csv ]; then
+        # --csv [--tsv] [--header] --col <n>:<from_unit>:<to_unit> ... [file]
+        if [[ $cur == -* ]]; then
+            COMPREPLY=($(compgen -W "--tsv --header --col" -- "$cur"))
+        else
+            COMPREPLY=($(compgen -f -- "$cur"))
+        fi
+        return
+    fi
+
+    if [ -z "$kind" ]; then
+        if [ "$COMP_CWORD" -eq 1 ] && [[ $cur == -* ]]; then
+            COMPREPLY=($(compgen -W "-h --help -v --version -c -u -Cg -Cd -C --eval --exact --extended --hist
+                --clrhist --hist-search --hist-range --batch --batch-file --binary --csv --serve --client
+                --units-file --constants-file --precision --scientific --shortest --stats --memo --history-mode --complete" -- "$cur"))
+            return
+        elif [ "$COMP_CWORD" -eq 1 ]; then
+            kind=constants
+        elif [[ $prev =~ ^[-+]?[0-9.]+([eE][-+]?[0-9]+)?$ ]] || [[ ${COMP_WORDS[COMP_CWORD - 2]} =~ ^[-+]?[0-9.]+([eE][-+]?[0-9]+)?$ ]]; then
+            # <value> <from_unit> <to_unit>
+            kind=units
+        else
+            return
+        fi
+    fi
+
+    # One name per line, some with spaces, such as Nautical Mile
+    local IFS=$'\n'
+    COMPREPLY=($(uc --complete "$kind" "$cur" 2>/dev/null | sed 's/ /\\ /g'))
+}
+
+complete -F _uc_complete uc
@@ -0,0 +1,50 @@
+// arena.hpp: The arrays of a loaded table, carved from one allocation
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <span>
+#include <type_traits>
+
+
+// One block of memory, sized up front from the bytes of each array it will hold, that
+// hands out those arrays one after another. The columns, records and indexes of a table
+// loaded from text thus take a single allocation, lie next to each other, and are freed
+// together. Arrays are value-initialised and never destroyed, so their types must be
+// trivially destructible.
+class Arena {
+    private:
+        std::unique_ptr<std::byte[]> block;
+        std::size_t capacity = 0;
+        std::size_t used = 0;
+
+    public:
+        // Bytes taken by count values of T, rounded up so that every array stays aligned
+        template <class T>
+        static constexpr std::size_t bytes(std::size_t count) {
+            constexpr std::size_t alignment = alignof(std::max_align_t);
+            return (count * sizeof(T) + alignment - 1) / alignment * alignment;
+        }
+
+        Arena() = default;
+
+        explicit Arena(std::size_t size)
+            : block(size == 0 ? nullptr : std::make_unique_for_overwrite<std::byte[]>(size)), capacity(size) {}
+
+        Arena(const Arena&) = delete;
+        Arena& operator=(const Arena&) = delete;
+
+        // The next count values. Throws std::bad_alloc beyond the size given.
+        template <class T>
+        std::span<T> allocate(std::size_t count) {
+            static_assert(std::is_trivially_destructible_v<T> && alignof(T) <= alignof(std::max_align_t));
+            const std::size_t size = bytes<T>(count);
+            if (size > capacity - used)
+                throw std::bad_alloc();
+            T* values = reinterpret_cast<T*>(block.get() + used);
+            std::uninitialized_value_construct_n(values, count);
+            used += size;
+            return { values, count };
+        }
+};
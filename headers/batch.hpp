@@ -0,0 +1,107 @@
+// batch.hpp: Conversion of many values at once, from lines of text or binary columns
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "history.hpp"
+#include "number_format.hpp"
+#include "tables.hpp"
+#include "units.hpp"
+
+
+// Parses a whole token as a double. Returns false on trailing garbage or overflow.
+bool parseNumber(std::string_view token, double& value);
+
+
+// Splits a line on whitespace into views of its fields, without copying them
+void splitFields(std::string_view line, std::vector<std::string_view>& fields);
+
+
+// A unit pair applied to every line of a batch, resolved once before any input is read.
+// The ids are unknownUnit for a side that is a unit expression.
+struct BatchPair {
+    std::string_view unitFrom;
+    std::string_view unitTo;
+    UnitId from = unknownUnit;
+    UnitId to = unknownUnit;
+    Conversion conversion;
+};
+
+
+// Resolves unitFrom/unitTo, throwing std::invalid_argument if they cannot be converted
+BatchPair resolvePair(const Units& u, std::string_view unitFrom, std::string_view unitTo);
+
+
+// Converts the fields of a batch line: `<value> <from_unit> <to_unit>`, or `<value>` given
+// a fixed pair. Throws std::invalid_argument describing why the line cannot be converted.
+// A successful conversion is recorded in history, when given, with History::record.
+double convertFields(std::span<const std::string_view> fields, const Units& u, const BatchPair* pair,
+                     std::string* history);
+
+
+// Converts input line by line, writing one result per line to out. Each line is
+// `<value> <from_unit> <to_unit>`, or just `<value>` when unitFrom/unitTo are given.
+// Lines that fail are reported on errors, numbered from firstLine, and skipped; converted
+// lines are recorded in history when given. Results are written in format through an
+// OutputBuffer. Returns the number of failures; throws std::invalid_argument if
+// unitFrom/unitTo cannot be converted.
+std::size_t convertLines(std::istream& in, std::ostream& out, std::ostream& errors, const Units& u,
+                         const std::string& unitFrom, const std::string& unitTo, std::size_t firstLine,
+                         std::string* history = nullptr, const NumberFormat& format = {});
+
+
+// Converts the lines of text as convertLines does, parsing in place with std::from_chars
+// and appending results, formatted with appendNumber, to out.
+std::size_t convertText(std::string_view text, std::string& out, std::string& errors, const Units& u,
+                        const BatchPair* pair, std::size_t firstLine, std::string* history = nullptr,
+                        const NumberFormat& format = {});
+
+
+// Converts input as convertLines does, reporting failures on std::cerr. With more than one
+// job, blocks of lines are converted on a work-stealing pool and written in input order.
+// Given a history, each block's conversions are appended to it in one group commit.
+std::size_t convertBatch(std::istream& in, std::ostream& out, const Units& u, const std::string& unitFrom = "",
+                         const std::string& unitTo = "", unsigned jobs = 1, History* history = nullptr,
+                         const NumberFormat& format = {});
+
+
+// Converts a file as convertLines does, reading it through a memory map so that lines
+// are parsed in place and never copied. Blocks of about 8 MiB are converted, on a
+// work-stealing pool with more than one job, and written to fd in input order. Given a
+// history, each block's conversions are appended to it in one group commit. Returns the
+// number of failures, which are reported on std::cerr.
+std::size_t convertMappedFile(const std::string& path, int fd, const Units& u, const std::string& unitFrom = "",
+                              const std::string& unitTo = "", unsigned jobs = 1, History* history = nullptr,
+                              const NumberFormat& format = {});
+
+
+// Header that may precede a binary column: the unit of its values and, optionally, the
+// unit to convert them to. Unit symbols are NUL padded.
+struct BinaryHeader {
+    char magic[4] = { 'U', 'C', 'B', '1' };
+    std::uint8_t width = 8;
+    std::uint8_t reserved[3] = {};
+    char from[16] = {};
+    char to[16] = {};
+};
+
+
+// Reverses the bytes of each width-byte value on big-endian hosts, where the
+// little-endian column format differs from memory order
+void toLittleEndian(char* data, std::size_t size, std::size_t width);
+
+
+// Converts a column of raw little-endian float64 (width 8) or float32 (width 4) values
+// from inFd to outFd, with no text formatting. With header, the input starts with a
+// BinaryHeader giving the width and source unit, and the target unit unless unitTo is
+// given; the output then starts with a header naming the target unit. Returns the number
+// of values converted; throws std::invalid_argument for bad units or truncated input.
+std::size_t convertBinary(int inFd, int outFd, const Units& u, std::string unitFrom, std::string unitTo,
+                          std::size_t width, bool header);
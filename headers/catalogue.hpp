@@ -0,0 +1,37 @@
+// catalogue.hpp: Unit and constant files loaded over the built-in tables, cached as
+// binary snapshots so that large catalogues load in the time of a file mapping
+#pragma once
+
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "units.hpp"
+
+
+// Unit and constant tables laid out like listOfUnits and listOfConstants, in load order
+struct CatalogueFiles {
+    std::vector<std::string> units;
+    std::vector<std::string> constants;
+
+    bool empty() const {
+        return units.empty() && constants.empty();
+    }
+};
+
+
+// Files named by a UC_UNITS_PATH value: a colon-separated list of unit tables and of
+// directories, each directory adding its units.dat and constants.dat where present
+CatalogueFiles catalogueFiles(std::string_view searchPath);
+
+// $XDG_CACHE_HOME/uc, or ~/.cache/uc
+std::filesystem::path snapshotDirectory();
+
+// Loads the built-in tables and then files, later tables overriding earlier ones. Reuses
+// the snapshot in cacheDirectory written for the same files when their sizes and
+// modification times still match, and otherwise parses the files and writes a snapshot
+// for next time; an empty cacheDirectory does neither. Returns whether a snapshot was
+// used. Throws std::runtime_error if a file cannot be read or is not a table, leaving u
+// and c as they were.
+bool loadCatalogue(Units& u, Constants& c, const CatalogueFiles& files, const std::filesystem::path& cacheDirectory);
@@ -0,0 +1,73 @@
+// cli.hpp: The uc command line, over libuc
+#pragma once
+
+#include <cstddef>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+#include "history.hpp"
+#include "libuc.hpp"
+
+
+bool isSwitch(const std::string& input);
+std::string toUpper(const std::string& input);
+
+void listCategories(const Units& u, std::ostream& out);
+void listUnits(const Units& u, const std::string& input, std::ostream& out);
+void listGroups(const Constants& c, std::ostream& out);
+void listConstants(const Constants& c, const std::string& input, std::ostream& out);
+void listConstantsDetailed(const Constants& c, std::ostream& out);
+void valueOfConstant(const Constants& c, const std::string& input, std::ostream& out);
+
+// Prints the unit symbols and names, categories, constant symbols and names or groups
+// (as kind is units, categories, constants or groups) that start with prefix, ignoring
+// case, one per line. Throws std::invalid_argument for any other kind.
+void completeKeys(const Units& u, const Constants& c, const std::string& kind, const std::string& prefix, std::ostream& out);
+
+// ". Did you mean ...?" for the first of unitFrom and unitTo that is not a unit of u or a
+// valid expression of them, or "" when both are
+std::string unknownUnitHint(const Units& u, std::string_view unitFrom, std::string_view unitTo);
+
+// Prints amount converted from unitFrom to unitTo in format and records it in history,
+// or prints why it cannot be converted
+void convertUnit(const Units& u, History& history, double amount, const std::string& unitFrom, const std::string& unitTo,
+                 const NumberFormat& format = {});
+
+// As convertUnit, for value as written: in exact rational arithmetic, printing every
+// digit of a terminating result and 20 decimals of any other, or in long double, printed
+// in format. Throws
+// std::invalid_argument if value is not a number and std::out_of_range if it is too large
+// or, when exact, has too many digits.
+void convertUnitPrecise(const Units& u, History& history, const std::string& value, const std::string& unitFrom,
+                        const std::string& unitTo, bool exact,
+                        const NumberFormat& format = { NumberStyle::Shortest });
+
+// Prints the value of the formula text, converted from unitFrom to unitTo when given, or
+// why it cannot be compiled. A formula that uses x is evaluated for each value read from
+// std::cin instead.
+void evaluateFormula(const Units& u, const Constants& c, const std::string& text, const std::string& unitFrom = "",
+                     const std::string& unitTo = "", const NumberFormat& format = {});
+
+// Appends the hits and misses of the memo of u, when enabled, to out
+void appendMemoStats(const Units& u, std::string& out);
+
+// Answers one request made to `uc --serve`: a conversion `<value> <from_unit> <to_unit>`,
+// a constant name or symbol, `--eval <formula>` without x, one of the listing options with
+// its argument, or --stats. The answer is appended to response as uc would print it;
+// returns false, with the message as the answer, for requests that fail. Conversions are
+// not recorded in the history.
+bool serveRequest(std::string_view request, const Units& u, const Constants& c, std::string& response);
+
+// Sends requests to a `uc --serve` daemon listening on socketPath and prints the answers
+// in order. Lines read from in are pipelined in blocks of about 1 MiB. Returns the number
+// of requests that failed.
+std::size_t clientRequests(const std::string& socketPath, std::istream& in);
+
+void printUsage();
+
+// Runs the uc command line with the given arguments, printing to std::cout. Returns the
+// exit status: EXIT_FAILURE if a daemon answered a --client request with an error, and
+// otherwise EXIT_SUCCESS.
+int uc(int argc, char* argv[], Units& u, Constants& c);
@@ -0,0 +1,64 @@
+// csv.hpp: Conversion of selected columns of CSV and TSV text, passing the rest through
+#pragma once
+
+#include <cstddef>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "batch.hpp"
+#include "number_format.hpp"
+#include "units.hpp"
+
+
+// A column to convert, counted from 0, with its unit pair resolved before any input is read
+struct CsvColumn {
+    std::size_t index;
+    BatchPair pair;
+};
+
+
+// Parses a column given as `<column>:<from_unit>:<to_unit>`, counting columns from 1, and
+// resolves its units through u. Throws std::invalid_argument for a malformed column and
+// for units that cannot be converted. The units view spec, which must outlive the column.
+CsvColumn parseCsvColumn(const Units& u, std::string_view spec);
+
+
+// Converts the numbers of some columns of delimited records, such as CSV exports, and
+// copies everything else unchanged: untouched bytes are copied straight from the input in
+// runs as long as the text between two converted fields, never split into fields and
+// rejoined. Fields may be quoted, with "" for a quote; a quoted number is written
+// unquoted. Empty fields pass through, as do fields that are not numbers, which are
+// reported. Records end with \n or \r\n.
+class CsvConverter {
+    private:
+        // In column order
+        std::vector<CsvColumn> columns;
+        char delimiter;
+        bool header;
+        NumberFormat format;
+        std::size_t records = 0;
+        std::size_t failed = 0;
+
+    public:
+        // Throws std::invalid_argument if a column is given twice or no column is given
+        explicit CsvConverter(std::vector<CsvColumn> columns, char delimiter = ',', bool header = false,
+                              const NumberFormat& format = {});
+
+        // Converts the complete records at the start of text into out, reporting fields
+        // that are not numbers to errors, and returns the bytes used. A record is complete
+        // once its newline is read outside quotes, or, when last, at the end of text.
+        std::size_t convert(std::string_view text, bool last, std::string& out, std::string& errors);
+
+        // Fields reported so far
+        std::size_t failures() const {
+            return failed;
+        }
+};
+
+
+// Streams in through converter to out in blocks of about 1 MiB, reporting failures on
+// std::cerr. Returns the number of fields reported.
+std::size_t convertCsv(std::istream& in, std::ostream& out, CsvConverter& converter);
@@ -0,0 +1,29 @@
+// expressions.hpp: Compound unit expressions such as kg*m/s^2, MB/s or km/h
+#pragma once
+
+#include <optional>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "units.hpp"
+
+
+// A unit expression reduced to a scale and a product of base dimensions: km/h is
+// 1000/3600 times DISTANCE^1 TIME^-1. Base dimensions are categories, except that AREA
+// and VOLUME are powers of DISTANCE. Temperatures count as intervals, without offsets.
+struct UnitExpression {
+    double scale = 1;
+    // Sorted by category, without zero exponents
+    std::vector<std::pair<std::string_view, int>> dimension;
+};
+
+
+// True when text uses the operators of an expression: *, /, ^ or parentheses
+bool isUnitExpression(std::string_view text) noexcept;
+
+// Parses units, each a symbol or name of u, joined by * and /, raised to integer powers
+// with ^ and grouped with parentheses. Positive numbers scale without a unit, as in 1/s
+// or l/(100*km). Returns nullopt if text is malformed or names an unknown unit. Category
+// names viewed by the result belong to u.
+std::optional<UnitExpression> parseUnitExpression(const Units& u, std::string_view text);
@@ -0,0 +1,39 @@
+// file_io.hpp: Whole-buffer reads and writes on POSIX file descriptors
+#pragma once
+
+#include <cerrno>
+#include <cstddef>
+#include <stdexcept>
+#include <string_view>
+
+#include <unistd.h>
+
+
+// Writes all of data to fd, retrying short and interrupted writes
+inline void writeAll(int fd, std::string_view data) {
+    while (!data.empty()) {
+        ssize_t written = write(fd, data.data(), data.size());
+        if (written < 0 && errno == EINTR)
+            continue;
+        if (written < 0)
+            throw std::runtime_error("Unable to write output");
+        data.remove_prefix(static_cast<std::size_t>(written));
+    }
+}
+
+
+// Reads up to size bytes, stopping early only at end of input. Returns the bytes read.
+inline std::size_t readFull(int fd, char* data, std::size_t size) {
+    std::size_t total = 0;
+    while (total < size) {
+        ssize_t got = read(fd, data + total, size - total);
+        if (got < 0 && errno == EINTR)
+            continue;
+        if (got < 0)
+            throw std::runtime_error("Unable to read input");
+        if (got == 0)
+            break;
+        total += static_cast<std::size_t>(got);
+    }
+    return total;
+}
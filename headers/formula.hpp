@@ -0,0 +1,90 @@
+// formula.hpp: Arithmetic over constants and numbers, such as 2*pi*c/λ, compiled to bytecode
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "number_format.hpp"
+#include "units.hpp"
+
+
+// Why a formula cannot be compiled. name is the constant that was not found, or empty for
+// other errors, such as malformed text or units that cannot be converted.
+class FormulaError: public std::invalid_argument {
+    public:
+        std::string name;
+
+        explicit FormulaError(const std::string& message, std::string_view name = "")
+            : std::invalid_argument(message), name(name) {}
+};
+
+
+// A formula compiled for a stack machine. Constants are looked up and subexpressions
+// without the input folded to numbers when compiling, so evaluating only runs the
+// arithmetic that depends on the input: 2*pi*x/c is x, times 2π, divided by c.
+class Formula {
+    public:
+        enum class Op : std::uint8_t {
+            Push,
+            Input,
+            Add,
+            Subtract,
+            Multiply,
+            Divide,
+            Power,
+            Negate
+        };
+
+        // A binary operation takes its right operand from value when immediate, and
+        // otherwise from the stack
+        struct Instruction {
+            Op op;
+            bool immediate = false;
+            double value = 0;
+        };
+
+        // Values a formula may hold on the stack at once
+        static constexpr std::size_t maxDepth = 32;
+
+    private:
+        std::vector<Instruction> code;
+        bool input = false;
+
+        friend Formula compileFormula(const Units& u, const Constants& c, std::string_view text,
+                                      std::string_view unitFrom, std::string_view unitTo);
+
+    public:
+        // The formula's value for the input x. Never allocates or throws.
+        double evaluate(double x = 0) const noexcept;
+
+        // Whether the formula uses the input, x
+        bool takesInput() const noexcept {
+            return input;
+        }
+
+        std::span<const Instruction> instructions() const noexcept {
+            return code;
+        }
+};
+
+
+// Compiles numbers, the constants of c by symbol or case-agnostic name, and the input x,
+// joined by +, -, *, / and ^ (right associative) and grouped with parentheses; names that
+// contain operators, or a constant called x, are written in braces, as {ln(2)}. Given
+// units, the result is converted from unitFrom to unitTo through u. Throws FormulaError.
+Formula compileFormula(const Units& u, const Constants& c, std::string_view text, std::string_view unitFrom = "",
+                       std::string_view unitTo = "");
+
+
+// Evaluates formula for each line of in, a number, writing one result per line to out in
+// format. Lines that are not numbers are reported on errors, numbered from 1, and
+// skipped. Returns the number of failures.
+std::size_t evaluateLines(std::istream& in, std::ostream& out, std::ostream& errors, const Formula& formula,
+                          const NumberFormat& format = {});
@@ -0,0 +1,448 @@
+// history.hpp: Conversion history kept in ~/.uc_history
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "file_io.hpp"
+#include "history_index.hpp"
+#include "history_writer.hpp"
+#include "number_format.hpp"
+
+
+// Numbered entries of the form `<index> uc <amount> <from> <to> <result>`, one per line,
+// with an index (see HistoryIndex) that answers tail, unit and time queries without
+// reading the whole file. Appends cost the same at any history size and are safe between
+// concurrent uc processes. With writeBehind they are made on a background thread.
+class History {
+    private:
+        std::filesystem::path path;
+        // Takes appends off the caller's thread, when enabled with writeBehind
+        std::unique_ptr<HistoryWriter> writer;
+
+        // Holds an exclusive lock on an open history file for the lifetime of the object.
+        // A file rotated or compacted while waiting for the lock is reopened at path.
+        class LockedFile {
+            public:
+                int fd = -1;
+
+                LockedFile(const std::filesystem::path& path, int flags) {
+                    while (true) {
+                        fd = open(path.c_str(), flags, 0644);
+                        if (fd < 0)
+                            throw std::runtime_error("Unable to open history file");
+                        while (flock(fd, LOCK_EX) != 0) {
+                            if (errno != EINTR) {
+                                close(fd);
+                                throw std::runtime_error("Unable to lock history file");
+                            }
+                        }
+                        struct stat opened, current;
+                        if (fstat(fd, &opened) == 0 && stat(path.c_str(), &current) == 0 && opened.st_ino == current.st_ino)
+                            break;
+                        close(fd);
+                    }
+                }
+
+                ~LockedFile() {
+                    flock(fd, LOCK_UN);
+                    close(fd);
+                }
+
+                LockedFile(const LockedFile&) = delete;
+                LockedFile& operator=(const LockedFile&) = delete;
+        };
+
+        // Index of the last entry, read from the end of the file. Only a file whose last
+        // line is not a numbered entry falls back to counting lines.
+        static std::size_t lastIndex(int fd) {
+            struct stat status;
+            if (fstat(fd, &status) != 0)
+                throw std::runtime_error("Unable to read history file");
+            std::size_t size = static_cast<std::size_t>(status.st_size);
+            if (size == 0)
+                return 0;
+
+            char tail[4096];
+            std::size_t length = std::min(size, sizeof(tail));
+            if (pread(fd, tail, length, static_cast<off_t>(size - length)) != static_cast<ssize_t>(length))
+                throw std::runtime_error("Unable to read history file");
+
+            std::string_view text(tail, length);
+            if (text.back() == '\n')
+                text.remove_suffix(1);
+            std::size_t newline = text.rfind('\n');
+            if (newline != std::string_view::npos || length == size) {
+                std::string_view last = text.substr(newline == std::string_view::npos ? 0 : newline + 1);
+                std::size_t index;
+                auto [ptr, ec] = std::from_chars(last.data(), last.data() + last.size(), index);
+                if (ec == std::errc() && ptr != last.data())
+                    return index;
+            }
+
+            std::size_t lines = 0;
+            for (off_t offset = 0; static_cast<std::size_t>(offset) < size;) {
+                ssize_t got = pread(fd, tail, sizeof(tail), offset);
+                if (got <= 0)
+                    break;
+                lines += static_cast<std::size_t>(std::count(tail, tail + got, '\n'));
+                offset += got;
+            }
+            return lines;
+        }
+
+        // Writes bytes [start, end) of the history file to std::cout
+        static void copyRange(int fd, std::uint64_t start, std::uint64_t end) {
+            char buffer[1 << 16];
+            while (start < end) {
+                std::size_t length = static_cast<std::size_t>(std::min<std::uint64_t>(sizeof(buffer), end - start));
+                ssize_t got = pread(fd, buffer, length, static_cast<off_t>(start));
+                if (got <= 0)
+                    throw std::runtime_error("Unable to read history file");
+                std::cout.write(buffer, got);
+                start += static_cast<std::uint64_t>(got);
+            }
+            std::cout.flush();
+        }
+
+        // The entry starting at offset, without its newline
+        static std::string readEntry(int fd, std::uint64_t offset) {
+            std::string line;
+            char buffer[256];
+            while (true) {
+                ssize_t got = pread(fd, buffer, sizeof(buffer), static_cast<off_t>(offset + line.size()));
+                if (got <= 0)
+                    return line;
+                std::string_view chunk(buffer, static_cast<std::size_t>(got));
+                std::size_t newline = chunk.find('\n');
+                line.append(chunk.substr(0, newline));
+                if (newline != std::string_view::npos)
+                    return line;
+            }
+        }
+
+        // Runs query with the locked history file and its index, unless there is no history
+        template <typename Query>
+        void withIndex(Query query) const {
+            flush();
+            if (!std::filesystem::exists(path)) {
+                std::cout << "No conversion history found." << std::endl;
+                return;
+            }
+            try {
+                LockedFile file(path, O_RDWR);
+                HistoryIndex index(path, file.fd);
+                if (query(file.fd, index) == 0)
+                    std::cout << "No matching history entries found." << std::endl;
+            } catch (const std::exception& e) {
+                std::cout << e.what() << "." << std::endl;
+            }
+        }
+
+        // Appends message to ~/.uc_error.log
+        static void logError(std::string_view message) {
+            std::ofstream errorLog(home() / ".uc_error.log", std::ios::app);
+            if (errorLog.is_open())
+                errorLog << message << '\n';
+        }
+
+        // Appends records to the history at path, as append does without writeBehind. Each
+        // record is stamped with the time of the first of stamps that ends after it.
+        static void write(const std::filesystem::path& path, std::string_view records,
+                          std::span<const HistoryWriter::Stamp> stamps) {
+            UC_STATS_SCOPE(Stage::History);
+            try {
+                LockedFile file(path, O_RDWR | O_APPEND | O_CREAT);
+                HistoryIndex index(path, file.fd);
+                std::size_t number = lastIndex(file.fd);
+
+                std::string entries;
+                std::vector<HistoryRecord> indexed;
+                entries.reserve(records.size() + records.size() / 2);
+                for (std::size_t start = 0, stamp = 0; start < records.size();) {
+                    std::string_view fields = records.substr(start, records.find('\n', start) - start);
+                    while (stamp + 1 < stamps.size() && stamps[stamp].end <= start)
+                        ++stamp;
+                    start += fields.size() + 1;
+
+                    std::string_view field[4];
+                    for (std::string_view& value: field) {
+                        std::size_t tab = fields.find('\t');
+                        value = fields.substr(0, tab);
+                        fields.remove_prefix(std::min(value.size() + 1, fields.size()));
+                    }
+
+                    HistoryRecord entry;
+                    entry.offset = index.historyBytes() + entries.size();
+                    entry.time = stamps[stamp].time;
+                    HistoryIndex::setUnits(entry, field[1], field[2]);
+                    indexed.push_back(entry);
+                    std::format_to(std::back_inserter(entries), "{:<4} uc {} {} {} {}\n", ++number, field[0], field[1],
+                                   field[2], field[3]);
+                }
+                writeAll(file.fd, entries);
+                index.add(indexed, index.historyBytes() + entries.size());
+            } catch (const std::exception& e) {
+                logError(std::string("Error writing to history: ") + e.what());
+            }
+        }
+
+        // Stops the writer once it has written everything queued, logging records it dropped
+        void closeWriter() {
+            if (writer == nullptr)
+                return;
+            std::uint64_t dropped = writer->dropped();
+            writer.reset();
+            if (dropped != 0)
+                logError(std::format("Dropped {} history records: the history queue was full", dropped));
+        }
+
+    public:
+        explicit History(std::filesystem::path historyPath = defaultPath()) : path(std::move(historyPath)) {}
+
+        // Writes every queued record before returning
+        ~History() {
+            closeWriter();
+        }
+
+        History(const History&) = delete;
+        History& operator=(const History&) = delete;
+
+        // Makes later appends on a background thread, through a queue of about capacity
+        // batches that waits or drops records when full, as overflow says, so that callers
+        // never wait on the file system while the queue has room. Capacity 0 goes back to
+        // appending on the caller's thread. Queued records are written before the history
+        // is read or destroyed, and on flush.
+        void writeBehind(std::size_t capacity = HistoryWriter::defaultCapacity,
+                         HistoryOverflow overflow = HistoryOverflow::Block) {
+            closeWriter();
+            if (capacity != 0)
+                writer = std::make_unique<HistoryWriter>(
+                    capacity, overflow, [path = path](std::string_view records, std::span<const HistoryWriter::Stamp> stamps) {
+                        write(path, records, stamps);
+                    });
+        }
+
+        // Waits until every record appended so far is written
+        void flush() const {
+            if (writer != nullptr)
+                writer->flush();
+        }
+
+        static std::filesystem::path home() {
+            const char* home = getenv("HOME");
+            return home != nullptr ? std::filesystem::path(home) : std::filesystem::current_path();
+        }
+
+        static std::filesystem::path defaultPath() {
+            return home() / ".uc_history";
+        }
+
+        // Appends a record of one conversion to records, for append
+        static void record(std::string& records, double amount, std::string_view unitFrom, std::string_view unitTo,
+                           double result) {
+            appendNumber(records, amount, { NumberStyle::Shortest });
+            records.push_back('\t');
+            records += unitFrom;
+            records.push_back('\t');
+            records += unitTo;
+            records.push_back('\t');
+            appendNumber(records, result, { NumberStyle::General, 6 });
+            records.push_back('\n');
+        }
+
+        // Appends records made by record as numbered entries, and indexes them. The batch
+        // is written with a single write under an exclusive lock, so entries of concurrent
+        // processes never interleave. With writeBehind, records are queued and the call
+        // returns before they are written, stamped with the time of the call. Failures go
+        // to ~/.uc_error.log.
+        void append(std::string_view records) {
+            if (records.empty())
+                return;
+            const std::int64_t now = static_cast<std::int64_t>(std::time(nullptr));
+            if (writer != nullptr)
+                writer->push(records, now);
+            else
+                write(path, records, std::array{ HistoryWriter::Stamp{ records.size(), now } });
+        }
+
+        void append(double amount, std::string_view unitFrom, std::string_view unitTo, double result) {
+            std::string records;
+            record(records, amount, unitFrom, unitTo, result);
+            append(records);
+        }
+
+        void display() const {
+            flush();
+            if (!std::filesystem::exists(path)) {
+                std::cout << "No conversion history found." << std::endl;
+                return;
+            }
+
+            std::ifstream historyFile(path, std::ios::binary);
+            if (!historyFile.is_open()) {
+                std::cout << "Unable to open history file." << std::endl;
+                return;
+            }
+            if (historyFile.peek() != std::ifstream::traits_type::eof())
+                std::cout << historyFile.rdbuf();
+            std::cout.flush();
+        }
+
+        // Displays the last count entries
+        void tail(std::uint64_t count) const {
+            withIndex([count](int fd, const HistoryIndex& index) {
+                std::uint64_t first = index.count() > count ? index.count() - count : 0;
+                copyRange(fd, index.entryOffset(first), index.historyBytes());
+                return index.count() - first;
+            });
+        }
+
+        // Displays the entries converting from or to unit, oldest first, reading only the
+        // entries in the unit's index bucket
+        void search(std::string_view unit) const {
+            withIndex([unit](int fd, const HistoryIndex& index) {
+                const std::uint16_t bucket = HistoryIndex::bucketOf(unit);
+                std::vector<std::string> matches;
+                for (std::uint32_t link = index.head(bucket); link != 0;) {
+                    HistoryRecord record = index.record(link - 1);
+                    std::string line = readEntry(fd, record.offset);
+                    std::size_t units = HistoryIndex::unitsStart(line);
+                    if (units != std::string::npos && units + record.fromLength + 1 + record.toLength <= line.size()) {
+                        std::string_view entry(line);
+                        if (entry.substr(units, record.fromLength) == unit ||
+                            entry.substr(units + record.fromLength + 1, record.toLength) == unit)
+                            matches.push_back(std::move(line));
+                    }
+                    link = record.fromBucket == bucket ? record.prevFrom : record.prevTo;
+                }
+                for (auto match = matches.rbegin(); match != matches.rend(); ++match)
+                    std::cout << *match << '\n';
+                std::cout.flush();
+                return matches.size();
+            });
+        }
+
+        // Displays the entries made from start up to, but not including, end
+        void range(std::int64_t start, std::int64_t end) const {
+            withIndex([start, end](int fd, const HistoryIndex& index) {
+                std::uint64_t first = index.lowerBound(start);
+                std::uint64_t last = std::max(first, index.lowerBound(end));
+                copyRange(fd, index.entryOffset(first), index.entryOffset(last));
+                return last - first;
+            });
+        }
+
+        // Parses a time given as Unix seconds, `YYYY-MM-DD[THH:MM[:SS]]` in local time, or
+        // a span before now such as `30m`, `12h` or `7d`
+        static std::optional<std::int64_t> parseTime(std::string_view text) {
+            std::int64_t value;
+            auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+            if (ec == std::errc() && ptr == text.data() + text.size())
+                return value;
+            if (ec == std::errc() && ptr + 1 == text.data() + text.size() && value >= 0) {
+                const std::string_view units = "smhd";
+                const std::int64_t seconds[] = { 1, 60, 3600, 86400 };
+                std::size_t unit = units.find(*ptr);
+                if (unit != std::string_view::npos)
+                    return static_cast<std::int64_t>(std::time(nullptr)) - value * seconds[unit];
+            }
+
+            std::tm date = {};
+            int consumed = 0;
+            std::string input(text);
+            if (std::sscanf(input.c_str(), "%4d-%2d-%2d%n", &date.tm_year, &date.tm_mon, &date.tm_mday, &consumed) != 3)
+                return std::nullopt;
+            if (input[static_cast<std::size_t>(consumed)] == 'T' || input[static_cast<std::size_t>(consumed)] == ' ') {
+                int timeConsumed = 0;
+                if (std::sscanf(input.c_str() + consumed + 1, "%2d:%2d%n:%2d%n", &date.tm_hour, &date.tm_min,
+                                &timeConsumed, &date.tm_sec, &timeConsumed) < 2)
+                    return std::nullopt;
+                consumed += 1 + timeConsumed;
+            }
+            if (static_cast<std::size_t>(consumed) != input.size())
+                return std::nullopt;
+            date.tm_year -= 1900;
+            date.tm_mon -= 1;
+            date.tm_isdst = -1;
+            std::time_t time = std::mktime(&date);
+            if (time == static_cast<std::time_t>(-1))
+                return std::nullopt;
+            return static_cast<std::int64_t>(time);
+        }
+
+        // Empties the history and its index
+        void clear() const {
+            flush();
+            if (!std::filesystem::exists(path)) {
+                std::cout << "No history file found. Nothing to clear." << std::endl;
+                return;
+            }
+            LockedFile file(path, O_RDWR);
+            if (ftruncate(file.fd, 0) != 0)
+                throw std::runtime_error("Unable to clear history file");
+            // Opening the index of the emptied file resets it, while the lock is held
+            HistoryIndex index(path, file.fd);
+            std::cout << "Conversion history cleared." << std::endl;
+        }
+
+        // Drops all but the last keep entries, copying only those into a new history file
+        // and index that replace the old ones
+        void compact(std::uint64_t keep) const {
+            flush();
+            if (!std::filesystem::exists(path)) {
+                std::cout << "No history file found. Nothing to clear." << std::endl;
+                return;
+            }
+            LockedFile file(path, O_RDWR);
+            HistoryIndex index(path, file.fd);
+            std::uint64_t first = index.count() > keep ? index.count() - keep : 0;
+            std::vector<HistoryRecord> kept = index.records(first, index.count());
+            const std::uint64_t start = index.entryOffset(first);
+
+            const std::filesystem::path compacted(path.native() + ".tmp");
+            {
+                LockedFile output(compacted, O_RDWR | O_CREAT | O_TRUNC);
+                HistoryIndex compactedIndex(compacted, output.fd);
+                char buffer[1 << 16];
+                for (std::uint64_t offset = start; offset < index.historyBytes();) {
+                    std::size_t length = static_cast<std::size_t>(std::min<std::uint64_t>(sizeof(buffer), index.historyBytes() - offset));
+                    ssize_t got = pread(file.fd, buffer, length, static_cast<off_t>(offset));
+                    if (got <= 0)
+                        throw std::runtime_error("Unable to read history file");
+                    writeAll(output.fd, std::string_view(buffer, static_cast<std::size_t>(got)));
+                    offset += static_cast<std::uint64_t>(got);
+                }
+                for (HistoryRecord& record: kept) {
+                    record.offset -= start;
+                    record.prevFrom = record.prevTo = 0;
+                }
+                compactedIndex.add(kept, index.historyBytes() - start);
+            }
+            std::filesystem::rename(compacted, path);
+            std::filesystem::rename(HistoryIndex::pathFor(compacted), HistoryIndex::pathFor(path));
+            std::cout << std::format("Conversion history compacted to the last {} entries.", kept.size()) << std::endl;
+        }
+};
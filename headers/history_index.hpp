@@ -0,0 +1,305 @@
+// history_index.hpp: On-disk index of the entries in a history file
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+// Position, time and units of one history entry. Entries with a unit in the same bucket
+// are chained newest to oldest: prevFrom continues the from unit's bucket and prevTo the
+// to unit's, each holding the previous entry's position plus one (0 ends the chain).
+struct HistoryRecord {
+    std::uint64_t offset = 0;
+    std::int64_t time = 0;
+    std::uint32_t prevFrom = 0;
+    std::uint32_t prevTo = 0;
+    std::uint16_t fromLength = 0;
+    std::uint16_t toLength = 0;
+    std::uint16_t fromBucket = 0;
+    std::uint16_t toBucket = 0;
+};
+static_assert(sizeof(HistoryRecord) == 32);
+
+
+// Index kept beside a history file as `<history>.idx`: a header holding the chain heads
+// of every unit bucket, then one HistoryRecord per entry in file order. Records are
+// sorted by time, so time ranges are found by binary search, and the entries that
+// mention a unit are found by walking its bucket's chain. The caller must hold the
+// history file's lock for the lifetime of the object.
+class HistoryIndex {
+    public:
+        static constexpr std::size_t bucketCount = 4096;
+
+    private:
+        struct Header {
+            char magic[4] = { 'U', 'C', 'I', '1' };
+            std::uint32_t buckets = bucketCount;
+            std::uint64_t historyBytes = 0;
+            std::uint64_t historyInode = 0;
+            std::uint64_t count = 0;
+            std::array<std::uint32_t, bucketCount> heads = {};
+        };
+
+        // Changed bucket heads beyond which add rewrites them all in one write
+        static constexpr std::size_t maxHeadWrites = 16;
+
+        int fd;
+        Header header;
+        std::int64_t lastTime = 0;
+
+        static void readAt(int fd, void* data, std::size_t size, std::uint64_t offset) {
+            auto* bytes = static_cast<char*>(data);
+            while (size > 0) {
+                ssize_t got = pread(fd, bytes, size, static_cast<off_t>(offset));
+                if (got < 0 && errno == EINTR)
+                    continue;
+                if (got <= 0)
+                    throw std::runtime_error("Unable to read history index");
+                bytes += got;
+                size -= static_cast<std::size_t>(got);
+                offset += static_cast<std::uint64_t>(got);
+            }
+        }
+
+        static void writeAt(int fd, const void* data, std::size_t size, std::uint64_t offset) {
+            const auto* bytes = static_cast<const char*>(data);
+            while (size > 0) {
+                ssize_t written = pwrite(fd, bytes, size, static_cast<off_t>(offset));
+                if (written < 0 && errno == EINTR)
+                    continue;
+                if (written < 0)
+                    throw std::runtime_error("Unable to write history index");
+                bytes += written;
+                size -= static_cast<std::size_t>(written);
+                offset += static_cast<std::uint64_t>(written);
+            }
+        }
+
+        static std::uint64_t recordOffset(std::uint64_t position) {
+            return sizeof(Header) + position * sizeof(HistoryRecord);
+        }
+
+        // Indexes the entries in bytes [start, end) of the history file. Their times are
+        // unknown and taken from the entry before them.
+        void indexText(int historyFd, std::uint64_t start, std::uint64_t end) {
+            std::vector<HistoryRecord> records;
+            std::string text;
+            char buffer[1 << 16];
+            std::uint64_t lineStart = start;
+            for (std::uint64_t offset = start; offset < end;) {
+                std::size_t length = static_cast<std::size_t>(std::min<std::uint64_t>(sizeof(buffer), end - offset));
+                readAt(historyFd, buffer, length, offset);
+                text.append(buffer, length);
+                offset += length;
+
+                std::size_t newline;
+                while ((newline = text.find('\n')) != std::string::npos) {
+                    std::string_view line(text.data(), newline);
+                    HistoryRecord record;
+                    record.offset = lineStart;
+                    record.time = lastTime;
+                    std::size_t units = unitsStart(line);
+                    std::size_t resultStart = line.rfind(' ');
+                    if (units != std::string_view::npos && resultStart != std::string_view::npos && resultStart > units) {
+                        // Without the units known, a multi-word unit splits at its first space
+                        std::string_view both = line.substr(units, resultStart - units);
+                        std::size_t split = both.find(' ');
+                        if (split != std::string_view::npos)
+                            setUnits(record, both.substr(0, split), both.substr(split + 1));
+                    }
+                    records.push_back(record);
+                    lineStart += newline + 1;
+                    text.erase(0, newline + 1);
+                }
+            }
+            add(records, end - text.size());
+        }
+
+        void reset(std::uint64_t inode) {
+            header = Header();
+            header.historyInode = inode;
+            lastTime = 0;
+            if (ftruncate(fd, 0) != 0)
+                throw std::runtime_error("Unable to write history index");
+            writeAt(fd, &header, sizeof(header), 0);
+        }
+
+    public:
+        static std::filesystem::path pathFor(const std::filesystem::path& historyPath) {
+            return std::filesystem::path(historyPath.native() + ".idx");
+        }
+
+        static std::uint16_t bucketOf(std::string_view unit) {
+            std::uint64_t hash = 14695981039346656037ull;
+            for (char ch: unit) {
+                hash ^= static_cast<unsigned char>(ch);
+                hash *= 1099511628211ull;
+            }
+            return static_cast<std::uint16_t>(hash % bucketCount);
+        }
+
+        // Offset within an entry `<index> uc <amount> <from> <to> <result>` of its from
+        // unit, or npos if the line is not an entry
+        static std::size_t unitsStart(std::string_view line) {
+            std::size_t uc = line.find(" uc ");
+            if (uc == std::string_view::npos)
+                return std::string_view::npos;
+            std::size_t amountEnd = line.find(' ', uc + 4);
+            return amountEnd == std::string_view::npos ? amountEnd : amountEnd + 1;
+        }
+
+        static void setUnits(HistoryRecord& record, std::string_view from, std::string_view to) {
+            if (from.empty() || to.empty() || from.size() > UINT16_MAX || to.size() > UINT16_MAX)
+                return;
+            record.fromLength = static_cast<std::uint16_t>(from.size());
+            record.toLength = static_cast<std::uint16_t>(to.size());
+            record.fromBucket = bucketOf(from);
+            record.toBucket = bucketOf(to);
+        }
+
+        // Opens the index of the history file open on historyFd, rebuilding it if it
+        // belongs to another file and indexing any entries appended without it
+        HistoryIndex(const std::filesystem::path& historyPath, int historyFd)
+            : fd(open(pathFor(historyPath).c_str(), O_RDWR | O_CREAT, 0644)) {
+            if (fd < 0)
+                throw std::runtime_error("Unable to open history index");
+
+            try {
+                struct stat history, index;
+                if (fstat(historyFd, &history) != 0 || fstat(fd, &index) != 0)
+                    throw std::runtime_error("Unable to read history index");
+                const auto historySize = static_cast<std::uint64_t>(history.st_size);
+                const auto indexSize = static_cast<std::uint64_t>(index.st_size);
+
+                bool valid = indexSize >= sizeof(Header);
+                if (valid) {
+                    readAt(fd, &header, sizeof(header), 0);
+                    valid = std::memcmp(header.magic, Header().magic, sizeof(header.magic)) == 0 &&
+                            header.buckets == bucketCount && header.historyInode == history.st_ino &&
+                            header.historyBytes <= historySize && recordOffset(header.count) <= indexSize &&
+                            std::all_of(header.heads.begin(), header.heads.end(),
+                                        [this](std::uint32_t head) { return head <= header.count; });
+                }
+                if (!valid)
+                    reset(history.st_ino);
+                else if (header.count > 0)
+                    lastTime = record(header.count - 1).time;
+
+                if (header.historyBytes < historySize)
+                    indexText(historyFd, header.historyBytes, historySize);
+            } catch (...) {
+                close(fd);
+                throw;
+            }
+        }
+
+        ~HistoryIndex() {
+            close(fd);
+        }
+
+        HistoryIndex(const HistoryIndex&) = delete;
+        HistoryIndex& operator=(const HistoryIndex&) = delete;
+
+        std::uint64_t count() const {
+            return header.count;
+        }
+
+        // Bytes of the history file covered by the index
+        std::uint64_t historyBytes() const {
+            return header.historyBytes;
+        }
+
+        // Position plus one of the newest entry whose from or to unit falls in bucket
+        std::uint32_t head(std::uint16_t bucket) const {
+            return header.heads[bucket];
+        }
+
+        HistoryRecord record(std::uint64_t position) const {
+            HistoryRecord result;
+            readAt(fd, &result, sizeof(result), recordOffset(position));
+            return result;
+        }
+
+        // Records of the entries at positions [first, last)
+        std::vector<HistoryRecord> records(std::uint64_t first, std::uint64_t last) const {
+            std::vector<HistoryRecord> result(last - first);
+            if (!result.empty())
+                readAt(fd, result.data(), result.size() * sizeof(HistoryRecord), recordOffset(first));
+            return result;
+        }
+
+        // Offset of the entry at position, or the end of the indexed history
+        std::uint64_t entryOffset(std::uint64_t position) const {
+            return position < header.count ? record(position).offset : header.historyBytes;
+        }
+
+        // Position of the first entry at or after time
+        std::uint64_t lowerBound(std::int64_t time) const {
+            std::uint64_t low = 0, high = header.count;
+            while (low < high) {
+                std::uint64_t middle = low + (high - low) / 2;
+                if (record(middle).time < time)
+                    low = middle + 1;
+                else
+                    high = middle;
+            }
+            return low;
+        }
+
+        // Appends records for entries that now extend the history file to historyBytes,
+        // linking them into their buckets' chains. Times are raised to keep them sorted.
+        // Only the header fields that change are written: the counts and, for a few
+        // records, the heads of their buckets.
+        void add(std::vector<HistoryRecord>& records, std::uint64_t historyBytes) {
+            std::vector<std::uint16_t> changed;
+            for (HistoryRecord& record: records) {
+                record.time = std::max(record.time, lastTime);
+                lastTime = record.time;
+                if (record.fromLength == 0)
+                    continue;
+                auto position = static_cast<std::uint32_t>(header.count + static_cast<std::uint64_t>(&record - records.data()) + 1);
+                record.prevFrom = header.heads[record.fromBucket];
+                header.heads[record.fromBucket] = position;
+                changed.push_back(record.fromBucket);
+                if (record.toBucket == record.fromBucket) {
+                    record.prevTo = record.prevFrom;
+                } else {
+                    record.prevTo = header.heads[record.toBucket];
+                    header.heads[record.toBucket] = position;
+                    changed.push_back(record.toBucket);
+                }
+            }
+            writeAt(fd, records.data(), records.size() * sizeof(HistoryRecord), recordOffset(header.count));
+
+            std::sort(changed.begin(), changed.end());
+            changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+            const std::size_t heads = offsetof(Header, heads);
+            if (changed.size() > maxHeadWrites) {
+                writeAt(fd, header.heads.data(), sizeof(header.heads), heads);
+            } else {
+                for (std::uint16_t bucket: changed)
+                    writeAt(fd, &header.heads[bucket], sizeof(std::uint32_t), heads + bucket * sizeof(std::uint32_t));
+            }
+
+            // historyBytes through count, which hold the unchanged inode between them
+            header.count += records.size();
+            header.historyBytes = historyBytes;
+            const std::size_t first = offsetof(Header, historyBytes);
+            const std::size_t last = offsetof(Header, count) + sizeof(header.count);
+            writeAt(fd, reinterpret_cast<const char*>(&header) + first, last - first, first);
+        }
+};
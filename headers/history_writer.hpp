@@ -0,0 +1,177 @@
+// history_writer.hpp: Background thread that appends history records off the conversion path
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+
+// What an append does when the writer's queue is full
+enum class HistoryOverflow {
+    // Waits until the writer makes room
+    Block,
+    // Drops the records, which are counted
+    Drop
+};
+
+
+// Hands batches of history records from any thread to one writer thread, which appends
+// everything queued since its last write with a single call to write, along with the time
+// each batch was pushed. The queue is a
+// bounded ring whose slots carry a sequence number saying whether they are free for a
+// given turn or ready to read (Vyukov's bounded queue), so producers never lock; they
+// and the writer sleep on atomic waits. The thread starts with the first push, and the
+// destructor writes every batch pushed before it returns.
+class HistoryWriter {
+    public:
+        static constexpr std::size_t defaultCapacity = 256;
+
+        // Where a batch ends in the records written, and the time it was pushed with
+        struct Stamp {
+            std::size_t end;
+            std::int64_t time;
+        };
+
+        using Write = std::function<void(std::string_view records, std::span<const Stamp> stamps)>;
+
+    private:
+        struct Slot {
+            std::atomic<std::uint64_t> sequence = 0;
+            std::string records;
+            std::int64_t time = 0;
+        };
+
+        std::unique_ptr<Slot[]> slots;
+        std::size_t mask;
+        HistoryOverflow overflow;
+        Write write;
+
+        // Next turn to claim and batches written, on lines of their own
+        alignas(64) std::atomic<std::uint64_t> head = 0;
+        alignas(64) std::atomic<std::uint64_t> written = 0;
+        // Bumped to wake the writer, by pushes and by the destructor
+        std::atomic<std::uint32_t> signal = 0;
+        std::atomic<bool> stopping = false;
+        std::atomic<std::uint64_t> droppedRecords = 0;
+
+        std::once_flag started;
+        std::thread thread;
+
+        bool tryPush(std::string_view records, std::int64_t time) {
+            std::uint64_t turn = head.load(std::memory_order_relaxed);
+            while (true) {
+                Slot& slot = slots[turn & mask];
+                std::uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+                auto ahead = static_cast<std::int64_t>(sequence - turn);
+                if (ahead < 0)
+                    return false;
+                if (ahead > 0) {
+                    turn = head.load(std::memory_order_relaxed);
+                } else if (head.compare_exchange_weak(turn, turn + 1, std::memory_order_relaxed)) {
+                    slot.records.assign(records);
+                    slot.time = time;
+                    slot.sequence.store(turn + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+        }
+
+        void wake() {
+            signal.fetch_add(1, std::memory_order_release);
+            signal.notify_one();
+        }
+
+        void run() {
+            std::uint64_t tail = 0;
+            std::string batch;
+            std::vector<Stamp> stamps;
+            while (true) {
+                const std::uint32_t seen = signal.load(std::memory_order_acquire);
+                std::uint64_t popped = 0;
+                batch.clear();
+                stamps.clear();
+                for (Slot* slot = &slots[tail & mask]; slot->sequence.load(std::memory_order_acquire) == tail + 1;
+                     slot = &slots[tail & mask]) {
+                    batch += slot->records;
+                    stamps.push_back({ batch.size(), slot->time });
+                    slot->records.clear();
+                    slot->sequence.store(tail + mask + 1, std::memory_order_release);
+                    ++tail;
+                    ++popped;
+                }
+                if (popped != 0) {
+                    write(batch, stamps);
+                    written.fetch_add(popped, std::memory_order_release);
+                    written.notify_all();
+                    continue;
+                }
+                if (stopping.load(std::memory_order_acquire) && tail == head.load(std::memory_order_acquire))
+                    return;
+                signal.wait(seen, std::memory_order_acquire);
+            }
+        }
+
+    public:
+        // A queue of about capacity batches, rounded up to a power of two, written by write
+        HistoryWriter(std::size_t capacity, HistoryOverflow overflow, Write write)
+            : mask(std::bit_ceil(std::max<std::size_t>(capacity, 2)) - 1), overflow(overflow), write(std::move(write)) {
+            slots = std::make_unique<Slot[]>(mask + 1);
+            for (std::size_t i = 0; i <= mask; ++i)
+                slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+
+        ~HistoryWriter() {
+            stopping.store(true, std::memory_order_release);
+            wake();
+            if (thread.joinable())
+                thread.join();
+        }
+
+        HistoryWriter(const HistoryWriter&) = delete;
+        HistoryWriter& operator=(const HistoryWriter&) = delete;
+
+        // Queues records made at time for the writer. Returns false if they were dropped.
+        bool push(std::string_view records, std::int64_t time = 0) {
+            std::call_once(started, [this]() { thread = std::thread(&HistoryWriter::run, this); });
+            while (true) {
+                const std::uint64_t done = written.load(std::memory_order_acquire);
+                if (tryPush(records, time))
+                    break;
+                if (overflow == HistoryOverflow::Drop) {
+                    droppedRecords.fetch_add(static_cast<std::uint64_t>(std::count(records.begin(), records.end(), '\n')),
+                                             std::memory_order_relaxed);
+                    return false;
+                }
+                wake();
+                written.wait(done, std::memory_order_acquire);
+            }
+            wake();
+            return true;
+        }
+
+        // Waits until every batch pushed before the call is written, including those whose
+        // turn is claimed but not yet filled. Turns are written in order, so that is every
+        // turn claimed so far.
+        void flush() {
+            const std::uint64_t target = head.load(std::memory_order_acquire);
+            for (std::uint64_t done = written.load(std::memory_order_acquire); done < target;
+                 done = written.load(std::memory_order_acquire))
+                written.wait(done, std::memory_order_acquire);
+        }
+
+        // Records dropped because the queue was full
+        std::uint64_t dropped() const noexcept {
+            return droppedRecords.load(std::memory_order_relaxed);
+        }
+};
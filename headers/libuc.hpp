@@ -0,0 +1,27 @@
+// libuc.hpp: The unit converter as a library. Link with libuc (see build_lib.sh).
+#pragma once
+
+#include <expected>
+#include <string_view>
+
+#include "batch.hpp"
+#include "catalogue.hpp"
+#include "csv.hpp"
+#include "expressions.hpp"
+#include "formula.hpp"
+#include "quantity.hpp"
+#include "search.hpp"
+#include "tables.hpp"
+#include "units.hpp"
+
+
+namespace libuc {
+    // Converts amount between units of the built-in table, by symbol or case-agnostic
+    // name, or between expressions of them such as km/h. Never throws; safe to call from
+    // any thread. Allocates only to compile an expression not already cached.
+    std::expected<double, Error> convert(double amount, std::string_view unitFrom, std::string_view unitTo) noexcept;
+
+    // Value of a built-in constant, by symbol or case-agnostic name. Never allocates or
+    // throws; safe to call from any thread.
+    std::expected<double, Error> constant(std::string_view input) noexcept;
+}
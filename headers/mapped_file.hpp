@@ -0,0 +1,69 @@
+// mapped_file.hpp: Read-only memory mapping of a whole file
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+// Maps a file read-only for sequential access. The mapping is released on destruction.
+class MappedFile {
+    private:
+        void* data = nullptr;
+        std::size_t size = 0;
+
+    public:
+        // Throws std::runtime_error if the file cannot be opened or mapped
+        explicit MappedFile(const std::string& path) {
+            int fd = open(path.c_str(), O_RDONLY);
+            if (fd < 0)
+                throw std::runtime_error("Unable to open file: " + path);
+
+            struct stat status;
+            if (fstat(fd, &status) != 0) {
+                close(fd);
+                throw std::runtime_error("Unable to open file: " + path);
+            }
+            size = static_cast<std::size_t>(status.st_size);
+
+            // mmap rejects empty mappings; an empty file is an empty view
+            if (size > 0) {
+                data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (data == MAP_FAILED) {
+                    close(fd);
+                    throw std::runtime_error("Unable to map file: " + path);
+                }
+                madvise(data, size, MADV_SEQUENTIAL);
+            }
+            close(fd);
+        }
+
+        ~MappedFile() {
+            if (data != nullptr)
+                munmap(data, size);
+        }
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        std::string_view view() const {
+            return { static_cast<const char*>(data), size };
+        }
+
+        // Drops the pages of a range that has been read, so files larger than memory
+        // stream through without evicting everything else
+        void release(std::size_t offset, std::size_t length) {
+            std::size_t page = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+            std::size_t start = offset / page * page;
+            std::size_t end = std::min(offset + length, size) / page * page;
+            if (data != nullptr && end > start)
+                madvise(static_cast<char*>(data) + start, end - start, MADV_DONTNEED);
+        }
+};
@@ -0,0 +1,161 @@
+// memo_cache.hpp: Bounded, lock-free memo of conversion results keyed by unit ids and amount
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+
+#include "tables.hpp"
+
+
+// Hits and misses of a MemoCache since it was sized or cleared
+struct MemoStats {
+    std::uint64_t hits = 0;
+    std::uint64_t misses = 0;
+    std::size_t capacity = 0;
+};
+
+
+// Remembers the result of recent (from, to, amount) conversions, with from and to ids
+// of loaded units or constants and the amount compared bit for bit. Slots are split into
+// shards, each with its own counters on a cache line of their own, and a key's hash
+// picks a shard and a slot in it; a new result replaces the slot's last. Each slot is guarded
+// by a sequence number, odd while written: readers never wait, and miss when a slot
+// changes under them, and a writer that finds a slot being written skips it. Safe to
+// share between threads. Copies start empty with the same capacity, since ids belong to
+// the tables they were resolved in. Disabled, at the cost of a branch, with capacity 0.
+class MemoCache {
+    public:
+        static constexpr std::size_t shardCount = 16;
+
+    private:
+        struct Slot {
+            std::atomic<std::uint64_t> sequence = 0;
+            std::atomic<std::uint64_t> ids = 0;
+            std::atomic<std::uint64_t> amount = 0;
+            std::atomic<std::uint64_t> result = 0;
+        };
+
+        // Counters of the shard's slots, each on its own cache line
+        struct alignas(64) Shard {
+            std::atomic<std::uint64_t> hits = 0;
+            std::atomic<std::uint64_t> misses = 0;
+        };
+
+        // Slots per shard, a power of two, or 0 when disabled
+        std::size_t shardSize = 0;
+        // Shard by shard
+        std::unique_ptr<Slot[]> slots;
+        std::array<Shard, shardCount> shards;
+
+        // Ids packed with 1 added, so that 0 is never a key and empty slots never match
+        static std::uint64_t packIds(UnitId from, UnitId to) noexcept {
+            return (std::uint64_t(from) << 32 | to) + 1;
+        }
+
+        static std::uint64_t hash(std::uint64_t ids, std::uint64_t amount) noexcept {
+            std::uint64_t h = (ids * 0x9e3779b97f4a7c15ull) ^ amount;
+            h ^= h >> 29;
+            h *= 0xbf58476d1ce4e5b9ull;
+            return h ^ (h >> 32);
+        }
+
+        Slot& slot(std::uint64_t h, Shard*& shard) noexcept {
+            std::size_t index = static_cast<std::size_t>(h >> 60);
+            shard = &shards[index];
+            return slots[index * shardSize + (h & (shardSize - 1))];
+        }
+
+    public:
+        // A memo of about capacity results, rounded up to a power of two per shard
+        explicit MemoCache(std::size_t capacity = 0) {
+            resize(capacity);
+        }
+
+        MemoCache(const MemoCache& other) : MemoCache(other.capacity()) {}
+
+        MemoCache& operator=(const MemoCache& other) {
+            if (this != &other)
+                resize(other.capacity());
+            return *this;
+        }
+
+        // Empties the memo and sizes it for about capacity results, or disables it with 0.
+        // Not safe while other threads use the memo.
+        void resize(std::size_t capacity) {
+            shardSize = capacity == 0 ? 0 : std::bit_ceil((capacity + shardCount - 1) / shardCount);
+            slots = shardSize == 0 ? nullptr : std::make_unique<Slot[]>(shardSize * shardCount);
+            for (Shard& shard: shards) {
+                shard.hits = 0;
+                shard.misses = 0;
+            }
+        }
+
+        // Forgets every result, as when the ids they were keyed on change. Not safe while
+        // other threads use the memo.
+        void clear() {
+            resize(capacity());
+        }
+
+        bool enabled() const noexcept {
+            return shardSize != 0;
+        }
+
+        std::size_t capacity() const noexcept {
+            return shardSize * shardCount;
+        }
+
+        // The result remembered for the conversion, counting a hit or miss. Only when enabled.
+        std::optional<double> find(UnitId from, UnitId to, double amount) noexcept {
+            const std::uint64_t ids = packIds(from, to);
+            const std::uint64_t bits = std::bit_cast<std::uint64_t>(amount);
+            Shard* shard;
+            Slot& s = slot(hash(ids, bits), shard);
+
+            std::uint64_t before = s.sequence.load(std::memory_order_acquire);
+            std::uint64_t storedIds = s.ids.load(std::memory_order_relaxed);
+            std::uint64_t storedAmount = s.amount.load(std::memory_order_relaxed);
+            std::uint64_t result = s.result.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (before % 2 == 0 && storedIds == ids && storedAmount == bits
+                && s.sequence.load(std::memory_order_relaxed) == before) {
+                shard->hits.fetch_add(1, std::memory_order_relaxed);
+                return std::bit_cast<double>(result);
+            }
+            shard->misses.fetch_add(1, std::memory_order_relaxed);
+            return std::nullopt;
+        }
+
+        // Remembers result for the conversion, unless another thread is writing its slot.
+        // Only when enabled.
+        void insert(UnitId from, UnitId to, double amount, double result) noexcept {
+            const std::uint64_t ids = packIds(from, to);
+            const std::uint64_t bits = std::bit_cast<std::uint64_t>(amount);
+            Shard* shard;
+            Slot& s = slot(hash(ids, bits), shard);
+
+            std::uint64_t sequence = s.sequence.load(std::memory_order_relaxed);
+            if (sequence % 2 != 0 || !s.sequence.compare_exchange_strong(sequence, sequence + 1, std::memory_order_acquire))
+                return;
+            std::atomic_thread_fence(std::memory_order_release);
+            s.ids.store(ids, std::memory_order_relaxed);
+            s.amount.store(bits, std::memory_order_relaxed);
+            s.result.store(std::bit_cast<std::uint64_t>(result), std::memory_order_relaxed);
+            s.sequence.store(sequence + 2, std::memory_order_release);
+        }
+
+        // Counters summed over the shards; exact once other threads are done
+        MemoStats stats() const noexcept {
+            MemoStats total;
+            total.capacity = capacity();
+            for (const Shard& shard: shards) {
+                total.hits += shard.hits.load(std::memory_order_relaxed);
+                total.misses += shard.misses.load(std::memory_order_relaxed);
+            }
+            return total;
+        }
+};
@@ -0,0 +1,137 @@
+// number_format.hpp: Number formatting with std::to_chars into reusable output buffers
+#pragma once
+
+#include <charconv>
+#include <cstddef>
+#include <limits>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+#include "stats.hpp"
+
+
+enum class NumberStyle {
+    // precision decimals, as 32.8084
+    Fixed,
+    // precision decimals after one digit, as 3.2808e+01
+    Scientific,
+    // precision significant digits, fixed or scientific by size, as printf's %g
+    General,
+    // The fewest digits that read back as the same value, as 32.808398950131235
+    Shortest
+};
+
+
+struct NumberFormat {
+    NumberStyle style = NumberStyle::Fixed;
+    int precision = 4;
+};
+
+
+// Largest precision accepted for output, which keeps every number within a small buffer
+inline constexpr int maxNumberPrecision = 50;
+
+
+namespace number_format {
+    template <class T>
+    inline void append(std::string& out, T value, const NumberFormat& format) {
+        UC_STATS_SCOPE(Stage::Format);
+        // Room for every integer digit of the largest value, 309 for a double and 4933 for an
+        // 80-bit long double, with a sign, a point and every decimal
+        char buffer[std::numeric_limits<T>::max_exponent10 + 16 + maxNumberPrecision];
+        char* end = buffer + sizeof(buffer);
+        std::to_chars_result written;
+        switch (format.style) {
+            case NumberStyle::Fixed:
+                written = std::to_chars(buffer, end, value, std::chars_format::fixed, format.precision);
+                break;
+            case NumberStyle::Scientific:
+                written = std::to_chars(buffer, end, value, std::chars_format::scientific, format.precision);
+                break;
+            case NumberStyle::General:
+                written = std::to_chars(buffer, end, value, std::chars_format::general, format.precision);
+                break;
+            default:
+                written = std::to_chars(buffer, end, value);
+                break;
+        }
+        if (written.ec != std::errc())
+            throw std::range_error("Unable to format result");
+        out.append(buffer, written.ptr);
+    }
+}
+
+
+// Appends value to out in format. Precisions beyond maxNumberPrecision are not supported,
+// and throw std::range_error where the number does not fit.
+inline void appendNumber(std::string& out, double value, const NumberFormat& format = {}) {
+    number_format::append(out, value, format);
+}
+
+inline void appendNumber(std::string& out, long double value, const NumberFormat& format = {}) {
+    number_format::append(out, value, format);
+}
+
+
+// Collects text and numbers for an output stream, writing them in large blocks rather
+// than formatting into the stream value by value. Written to the stream when it holds
+// flushSize bytes, on flush, and when destroyed.
+class OutputBuffer {
+    private:
+        std::ostream& out;
+        NumberFormat format;
+        std::string buffer;
+
+    public:
+        static constexpr std::size_t flushSize = 1 << 16;
+
+        explicit OutputBuffer(std::ostream& out, NumberFormat format = {}) : out(out), format(format) {
+            buffer.reserve(flushSize + 512);
+        }
+
+        OutputBuffer(const OutputBuffer&) = delete;
+        OutputBuffer& operator=(const OutputBuffer&) = delete;
+
+        ~OutputBuffer() {
+            flush();
+        }
+
+        OutputBuffer& operator<<(std::string_view text) {
+            buffer += text;
+            return *this;
+        }
+
+        OutputBuffer& operator<<(char c) {
+            buffer.push_back(c);
+            if (c == '\n' && buffer.size() >= flushSize)
+                flush();
+            return *this;
+        }
+
+        OutputBuffer& operator<<(double value) {
+            appendNumber(buffer, value, format);
+            return *this;
+        }
+
+        OutputBuffer& operator<<(long double value) {
+            appendNumber(buffer, value, format);
+            return *this;
+        }
+
+        // text left-aligned in a field of width characters, as with std::setw and std::left
+        OutputBuffer& padded(std::string_view text, std::size_t width) {
+            buffer += text;
+            if (text.size() < width)
+                buffer.append(width - text.size(), ' ');
+            return *this;
+        }
+
+        // Writes what is buffered to the stream, without flushing the stream itself
+        void flush() {
+            out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+            buffer.clear();
+        }
+};
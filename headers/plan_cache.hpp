@@ -0,0 +1,92 @@
+// plan_cache.hpp: Least-recently-used cache of conversion plans keyed by unit pair
+#pragma once
+
+#include <cstddef>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+
+#include "tables.hpp"
+
+
+// Caches the plan compiled for each (from, to) pair of unit expressions, evicting the
+// least recently used beyond a capacity. Lookups do not allocate. Safe to share between
+// threads; copies start empty, since a plan belongs to the tables it was compiled from.
+template <class Plan>
+class PlanCache {
+    public:
+        static constexpr std::size_t defaultCapacity = 4096;
+
+    private:
+        struct Entry {
+            std::string from;
+            std::string to;
+            Plan plan;
+        };
+
+        using Key = std::pair<std::string_view, std::string_view>;
+
+        struct KeyHash {
+            std::size_t operator()(const Key& key) const noexcept {
+                return static_cast<std::size_t>(hashKey(key.first, false) * 31 + hashKey(key.second, false));
+            }
+        };
+
+        std::size_t capacity;
+        // Most recently used first. Keys of the index view the entries' strings, which
+        // stay in place as nodes are spliced.
+        std::list<Entry> entries;
+        std::unordered_map<Key, typename std::list<Entry>::iterator, KeyHash> index;
+        mutable std::mutex mutex;
+
+    public:
+        explicit PlanCache(std::size_t capacity = defaultCapacity) : capacity(capacity) {}
+
+        PlanCache(const PlanCache& other) : capacity(other.capacity) {}
+
+        PlanCache& operator=(const PlanCache& other) {
+            if (this != &other) {
+                clear();
+                std::lock_guard lock(mutex);
+                capacity = other.capacity;
+            }
+            return *this;
+        }
+
+        // The plan cached for the pair, marking it most recently used
+        std::optional<Plan> find(std::string_view from, std::string_view to) {
+            std::lock_guard lock(mutex);
+            auto found = index.find(Key(from, to));
+            if (found == index.end())
+                return std::nullopt;
+            entries.splice(entries.begin(), entries, found->second);
+            return found->second->plan;
+        }
+
+        void insert(std::string_view from, std::string_view to, const Plan& plan) {
+            std::lock_guard lock(mutex);
+            if (capacity == 0 || index.contains(Key(from, to)))
+                return;
+            if (entries.size() >= capacity) {
+                index.erase(Key(entries.back().from, entries.back().to));
+                entries.pop_back();
+            }
+            entries.push_front({ std::string(from), std::string(to), plan });
+            index.emplace(Key(entries.front().from, entries.front().to), entries.begin());
+        }
+
+        void clear() {
+            std::lock_guard lock(mutex);
+            index.clear();
+            entries.clear();
+        }
+
+        std::size_t size() const {
+            std::lock_guard lock(mutex);
+            return entries.size();
+        }
+};
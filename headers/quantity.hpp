@@ -0,0 +1,226 @@
+// quantity.hpp: Quantities typed by category and unit, converted at compile time from
+// the built-in table of tables.hpp. Header only.
+#pragma once
+
+#include <algorithm>
+#include <compare>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <type_traits>
+
+#include "tables.hpp"
+
+
+namespace libuc {
+    // A string literal usable as a template argument, such as the "km" of unit<"km">
+    template <std::size_t N>
+    struct fixed_string {
+        char text[N] = {};
+
+        constexpr fixed_string(const char (&literal)[N]) {
+            std::copy_n(literal, N, text);
+        }
+
+        constexpr std::string_view view() const {
+            return { text, N - 1 };
+        }
+    };
+
+
+    // Id of the built-in unit with the given symbol or case-agnostic name. Unknown units
+    // fail to compile.
+    consteval UnitId builtinUnitId(std::string_view unit) {
+        UnitId id = findKey(builtinUnitSymbols, unit, false);
+        if (id == unknownUnit)
+            id = findKey(builtinUnitNames, unit, true);
+        if (id == unknownUnit)
+            throw "Unknown unit";
+        return id;
+    }
+
+    // Number of the built-in category with the given name. Unknown categories fail to compile.
+    consteval std::uint32_t builtinCategory(std::string_view category) {
+        for (std::size_t i = 0; i < builtinUnitRecords.size(); ++i) {
+            if (builtinUnitRecords[i].category == category)
+                return builtinFactorStorage.categoryOf[i];
+        }
+        throw "Unknown category";
+    }
+
+
+    // A category of the built-in table, such as DISTANCE. Quantities of different
+    // dimensions do not convert, add or compare.
+    template <std::uint32_t Category>
+    struct dimension {
+        static constexpr std::uint32_t category = Category;
+    };
+
+    using data = dimension<builtinCategory("DATA")>;
+    using distance = dimension<builtinCategory("DISTANCE")>;
+    using volume = dimension<builtinCategory("VOLUME")>;
+    using area = dimension<builtinCategory("AREA")>;
+    using mass = dimension<builtinCategory("MASS")>;
+    using time = dimension<builtinCategory("TIME")>;
+    using temperature = dimension<builtinCategory("TEMPERATURE")>;
+
+
+    // A unit of the built-in table, by symbol or name
+    template <fixed_string Symbol>
+    struct unit {
+        static constexpr UnitId id = builtinUnitId(Symbol.view());
+        static constexpr UnitRecord record = builtinUnitRecords[id];
+        using dimension = libuc::dimension<builtinFactorStorage.categoryOf[id]>;
+    };
+
+
+    // Conversion from the unit From to the unit To, folded during compilation
+    template <class From, class To>
+    inline constexpr Conversion unitConversion = composeConversion(baseConversion(From::record),
+                                                                   baseConversion(To::record));
+
+
+    template <class Dim, class Unit, class Rep>
+    class quantity;
+
+    template <class T>
+    inline constexpr bool isQuantity = false;
+
+    template <class Dim, class Unit, class Rep>
+    inline constexpr bool isQuantity<quantity<Dim, Unit, Rep>> = true;
+
+
+    // Converts a quantity to another unit of its dimension. The conversion costs a
+    // multiply, plus an add between temperature scales.
+    template <class ToQuantity, class Dim, class Unit, class Rep>
+        requires isQuantity<ToQuantity> && std::same_as<typename ToQuantity::dimension, Dim>
+    constexpr ToQuantity quantity_cast(const quantity<Dim, Unit, Rep>& q) {
+        using ToRep = typename ToQuantity::rep;
+        constexpr Conversion c = unitConversion<Unit, typename ToQuantity::unit>;
+        using Common = std::common_type_t<Rep, ToRep, double>;
+        if constexpr (std::is_same_v<Unit, typename ToQuantity::unit>)
+            return ToQuantity(static_cast<ToRep>(q.count()));
+        else if constexpr (c.offset == 0)
+            return ToQuantity(static_cast<ToRep>(static_cast<Common>(q.count()) * c.scale));
+        else
+            return ToQuantity(static_cast<ToRep>(static_cast<Common>(q.count()) * c.scale + c.offset));
+    }
+
+
+    // An amount of Unit, which must belong to Dim. Like std::chrono::duration, a quantity
+    // converts implicitly to other units of its dimension when Rep is floating point, and
+    // through quantity_cast otherwise; quantities of different dimensions do not mix, so
+    // `quantity<mass, unit<"g">> q = metres;` is a compile error rather than the
+    // "Cannot convert between" error of Units::convertValue.
+    template <class Dim, class Unit, class Rep = double>
+    class quantity {
+        static_assert(std::is_arithmetic_v<Rep>, "A quantity's representation must be arithmetic");
+        static_assert(std::is_same_v<Dim, typename Unit::dimension>, "The unit does not belong to the dimension");
+
+        private:
+            Rep amount = 0;
+
+        public:
+            using dimension = Dim;
+            using unit = Unit;
+            using rep = Rep;
+
+            constexpr quantity() = default;
+
+            constexpr explicit quantity(Rep amount) : amount(amount) {}
+
+            template <class OtherUnit, class OtherRep>
+                requires std::is_floating_point_v<Rep> || std::is_same_v<OtherUnit, Unit>
+            constexpr quantity(const quantity<Dim, OtherUnit, OtherRep>& other)
+                : amount(quantity_cast<quantity>(other).count()) {}
+
+            constexpr Rep count() const {
+                return amount;
+            }
+
+            // The amount in another unit of the dimension
+            template <fixed_string Symbol>
+            constexpr Rep in() const {
+                return quantity_cast<quantity<Dim, libuc::unit<Symbol>, Rep>>(*this).count();
+            }
+
+            static constexpr std::string_view symbol() {
+                return Unit::record.symbol;
+            }
+
+            constexpr quantity operator-() const {
+                return quantity(-amount);
+            }
+
+            constexpr quantity& operator*=(Rep factor) {
+                amount *= factor;
+                return *this;
+            }
+
+            constexpr quantity& operator/=(Rep divisor) {
+                amount /= divisor;
+                return *this;
+            }
+
+            // Sums and differences are taken in the left-hand unit. Temperature scales
+            // are offset from each other, so their sums only combine equal units.
+            template <class OtherUnit, class OtherRep>
+                requires (unitConversion<OtherUnit, Unit>.offset == 0)
+            constexpr quantity& operator+=(const quantity<Dim, OtherUnit, OtherRep>& other) {
+                amount += quantity_cast<quantity>(other).count();
+                return *this;
+            }
+
+            template <class OtherUnit, class OtherRep>
+                requires (unitConversion<OtherUnit, Unit>.offset == 0)
+            constexpr quantity& operator-=(const quantity<Dim, OtherUnit, OtherRep>& other) {
+                amount -= quantity_cast<quantity>(other).count();
+                return *this;
+            }
+
+            friend constexpr quantity operator*(quantity q, Rep factor) {
+                return q *= factor;
+            }
+
+            friend constexpr quantity operator*(Rep factor, quantity q) {
+                return q *= factor;
+            }
+
+            friend constexpr quantity operator/(quantity q, Rep divisor) {
+                return q /= divisor;
+            }
+    };
+
+
+    // Binary operators take the left-hand unit and representation. They are templates
+    // over both operands, rather than friends, so that quantities of two units of a
+    // dimension find exactly one candidate.
+    template <class Dim, class Unit, class Rep, class OtherUnit, class OtherRep>
+        requires (unitConversion<OtherUnit, Unit>.offset == 0)
+    constexpr quantity<Dim, Unit, Rep> operator+(quantity<Dim, Unit, Rep> left, const quantity<Dim, OtherUnit, OtherRep>& right) {
+        return left += right;
+    }
+
+    template <class Dim, class Unit, class Rep, class OtherUnit, class OtherRep>
+        requires (unitConversion<OtherUnit, Unit>.offset == 0)
+    constexpr quantity<Dim, Unit, Rep> operator-(quantity<Dim, Unit, Rep> left, const quantity<Dim, OtherUnit, OtherRep>& right) {
+        return left -= right;
+    }
+
+    template <class Dim, class Unit, class Rep, class OtherUnit, class OtherRep>
+    constexpr bool operator==(const quantity<Dim, Unit, Rep>& left, const quantity<Dim, OtherUnit, OtherRep>& right) {
+        return left.count() == quantity_cast<quantity<Dim, Unit, Rep>>(right).count();
+    }
+
+    template <class Dim, class Unit, class Rep, class OtherUnit, class OtherRep>
+    constexpr auto operator<=>(const quantity<Dim, Unit, Rep>& left, const quantity<Dim, OtherUnit, OtherRep>& right) {
+        return left.count() <=> quantity_cast<quantity<Dim, Unit, Rep>>(right).count();
+    }
+
+
+    // A quantity of the unit with the given symbol, in that unit's dimension:
+    // quantity_of<"km"> is quantity<distance, unit<"km">>
+    template <fixed_string Symbol, class Rep = double>
+    using quantity_of = quantity<typename unit<Symbol>::dimension, unit<Symbol>, Rep>;
+}
@@ -0,0 +1,213 @@
+// rational.hpp: Exact rational arithmetic on 64-bit integers, for conversions that must
+// not round
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <optional>
+#include <string>
+#include <string_view>
+
+
+// num/den in lowest terms with den > 0. Operations return nullopt rather than overflow.
+struct Rational {
+    std::int64_t num = 0;
+    std::int64_t den = 1;
+
+    constexpr bool operator==(const Rational&) const = default;
+};
+
+
+namespace rational {
+    // a * b, or nullopt on overflow. The most negative value is excluded, so that every
+    // value can be negated.
+    constexpr std::optional<std::int64_t> multiply(std::int64_t a, std::int64_t b) {
+        std::int64_t product;
+        if (__builtin_mul_overflow(a, b, &product) || product == std::numeric_limits<std::int64_t>::min())
+            return std::nullopt;
+        return product;
+    }
+
+    constexpr std::optional<std::int64_t> add(std::int64_t a, std::int64_t b) {
+        std::int64_t sum;
+        if (__builtin_add_overflow(a, b, &sum) || sum == std::numeric_limits<std::int64_t>::min())
+            return std::nullopt;
+        return sum;
+    }
+
+    constexpr Rational reduce(std::int64_t num, std::int64_t den) {
+        if (den < 0) {
+            num = -num;
+            den = -den;
+        }
+        std::int64_t divisor = std::gcd(num, den);
+        return divisor > 1 ? Rational{ num / divisor, den / divisor } : Rational{ num, den };
+    }
+}
+
+
+constexpr std::optional<Rational> operator*(const Rational& a, const Rational& b) {
+    // Cross-cancelling first keeps the products as small as they can be
+    std::int64_t left = std::gcd(a.num, b.den);
+    std::int64_t right = std::gcd(b.num, a.den);
+    left = left == 0 ? 1 : left;
+    right = right == 0 ? 1 : right;
+    std::optional<std::int64_t> num = rational::multiply(a.num / left, b.num / right);
+    std::optional<std::int64_t> den = rational::multiply(a.den / right, b.den / left);
+    if (!num || !den)
+        return std::nullopt;
+    return *num == 0 ? Rational() : Rational{ *num, *den };
+}
+
+
+constexpr std::optional<Rational> operator/(const Rational& a, const Rational& b) {
+    if (b.num == 0)
+        return std::nullopt;
+    return a * (b.num < 0 ? Rational{ -b.den, -b.num } : Rational{ b.den, b.num });
+}
+
+
+constexpr std::optional<Rational> operator+(const Rational& a, const Rational& b) {
+    std::int64_t divisor = std::gcd(a.den, b.den);
+    std::optional<std::int64_t> left = rational::multiply(a.num, b.den / divisor);
+    std::optional<std::int64_t> right = rational::multiply(b.num, a.den / divisor);
+    std::optional<std::int64_t> den = rational::multiply(a.den / divisor, b.den);
+    if (!left || !right || !den)
+        return std::nullopt;
+    std::optional<std::int64_t> num = rational::add(*left, *right);
+    if (!num)
+        return std::nullopt;
+    return rational::reduce(*num, *den);
+}
+
+
+constexpr std::optional<Rational> operator-(const Rational& a, const Rational& b) {
+    return a + Rational{ -b.num, b.den };
+}
+
+
+// Parses a decimal such as 201.68 or 6.67430e-11 exactly, or returns nullopt if it is
+// malformed or its digits do not fit in 64 bits
+constexpr std::optional<Rational> parseRational(std::string_view text) {
+    std::size_t i = 0;
+    bool negative = !text.empty() && text[0] == '-';
+    if (!text.empty() && (text[0] == '-' || text[0] == '+'))
+        ++i;
+
+    std::int64_t num = 0;
+    int exponent = 0;
+    bool digits = false;
+    for (bool fraction = false; i < text.size(); ++i) {
+        if (text[i] >= '0' && text[i] <= '9') {
+            std::optional<std::int64_t> shifted = rational::multiply(num, 10);
+            std::optional<std::int64_t> next = shifted ? rational::add(*shifted, text[i] - '0') : std::nullopt;
+            if (!next)
+                return std::nullopt;
+            num = *next;
+            exponent -= fraction ? 1 : 0;
+            digits = true;
+        } else if (text[i] == '.' && !fraction) {
+            fraction = true;
+        } else {
+            break;
+        }
+    }
+
+    if (i < text.size() && (text[i] == 'e' || text[i] == 'E')) {
+        bool negativeExponent = i + 1 < text.size() && text[i + 1] == '-';
+        i += i + 1 < text.size() && (text[i + 1] == '-' || text[i + 1] == '+') ? 2 : 1;
+        int value = 0;
+        bool exponentDigits = false;
+        for (; i < text.size() && text[i] >= '0' && text[i] <= '9' && value < 1000; ++i) {
+            value = value * 10 + (text[i] - '0');
+            exponentDigits = true;
+        }
+        digits = digits && exponentDigits;
+        exponent += negativeExponent ? -value : value;
+    }
+    if (!digits || i != text.size())
+        return std::nullopt;
+
+    std::int64_t den = 1;
+    for (; exponent > 0; --exponent) {
+        std::optional<std::int64_t> shifted = rational::multiply(num, 10);
+        if (!shifted)
+            return std::nullopt;
+        num = *shifted;
+    }
+    for (; exponent < 0; ++exponent) {
+        std::optional<std::int64_t> shifted = rational::multiply(den, 10);
+        if (!shifted)
+            return std::nullopt;
+        den = *shifted;
+    }
+    return rational::reduce(negative ? -num : num, den);
+}
+
+
+// The nearest long double, or double with toDouble
+constexpr long double toLongDouble(const Rational& r) {
+    return static_cast<long double>(r.num) / static_cast<long double>(r.den);
+}
+
+constexpr double toDouble(const Rational& r) {
+    return static_cast<double>(toLongDouble(r));
+}
+
+
+// r in decimal: every digit when it terminates, and otherwise rounded half away from
+// zero to places decimals
+inline std::string formatRational(const Rational& r, int places = 20) {
+    std::uint64_t den = static_cast<std::uint64_t>(r.den);
+    std::uint64_t magnitude = r.num < 0 ? 0 - static_cast<std::uint64_t>(r.num) : static_cast<std::uint64_t>(r.num);
+    std::uint64_t rest = den;
+    while (rest % 2 == 0)
+        rest /= 2;
+    while (rest % 5 == 0)
+        rest /= 5;
+    const bool terminates = rest == 1;
+
+    std::string digits = std::to_string(magnitude / den);
+    std::uint64_t remainder = magnitude % den;
+    if (remainder != 0)
+        digits += '.';
+    // remainder * 10 may not fit in 64 bits, so it is added up modulo den
+    for (int place = 0; remainder != 0 && (terminates || place <= places); ++place) {
+        std::uint64_t next = 0;
+        int digit = 0;
+        for (int i = 0; i < 10; ++i) {
+            next += remainder;
+            if (next >= den) {
+                next -= den;
+                ++digit;
+            }
+        }
+        digits += static_cast<char>('0' + digit);
+        remainder = next;
+    }
+
+    if (!terminates) {
+        // The last digit generated only decides the rounding
+        bool up = digits.back() >= '5';
+        digits.pop_back();
+        for (std::size_t i = digits.size(); up && i-- > 0;) {
+            if (digits[i] == '.')
+                continue;
+            up = digits[i] == '9';
+            digits[i] = up ? '0' : static_cast<char>(digits[i] + 1);
+        }
+        if (up)
+            digits.insert(digits.begin(), '1');
+        if (digits.back() == '.')
+            digits.pop_back();
+    }
+    return r.num < 0 ? "-" + digits : digits;
+}
+
+
+// An affine map between two units in exact arithmetic: result = amount * scale + offset
+struct ExactConversion {
+    Rational scale = { 1, 1 };
+    Rational offset = { 0, 1 };
+};
@@ -0,0 +1,81 @@
+// search.hpp: Prefix completion and "did you mean" suggestions over unit and constant
+// names, for messages and shell completion
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "units.hpp"
+
+
+enum class SearchKind {
+    // Unit symbols and names, as in 10 km mi
+    Unit,
+    // Unit categories, as for -u
+    Category,
+    // Constant symbols and names
+    Constant,
+    // Constant groups, as for -C
+    Group
+};
+
+
+// Keys of loaded units and constants, folded to upper case and sorted, so that the keys
+// with a prefix are one contiguous run: a trie flattened into an array. Completion is a
+// binary search; suggestions walk the trie, sharing edit distance rows between keys with
+// a common prefix and skipping every key under a prefix already too distant. Keys view
+// the tables they were added from, which must outlive the index.
+class SearchIndex {
+    private:
+        struct Entry {
+            // The key's place in folded
+            std::uint32_t offset;
+            std::uint32_t length;
+            std::string_view key;
+            SearchKind kind;
+            // Position of the unit or constant in its table, or unknownUnit for categories
+            // and groups, so that a symbol and name of one record are suggested once
+            UnitId record;
+        };
+
+        // Every key folded to upper case, back to back
+        std::string folded;
+        std::vector<Entry> entries;
+
+        std::string_view foldedKey(const Entry& e) const {
+            return std::string_view(folded).substr(e.offset, e.length);
+        }
+
+        void add(std::string_view key, SearchKind kind, UnitId record);
+        void addUnits(const Units& u);
+        void addConstants(const Constants& c);
+        void build();
+
+    public:
+        SearchIndex() = default;
+
+        // Indexes every symbol, name and category of u
+        explicit SearchIndex(const Units& u);
+
+        // Indexes every symbol, name and group of c
+        explicit SearchIndex(const Constants& c);
+
+        SearchIndex(const Units& u, const Constants& c);
+
+        // Keys of kind starting with prefix, ignoring case, in order and without repeats.
+        // Returns at most limit keys, or all of them when limit is 0.
+        std::vector<std::string_view> complete(std::string_view prefix, SearchKind kind, std::size_t limit = 0) const;
+
+        // Up to limit keys of kind nearest to word, ignoring case: those within one edit
+        // (an insertion, deletion, substitution or swap of adjacent characters) of words
+        // up to four characters long and two of longer words, nearest first
+        std::vector<std::string_view> suggest(std::string_view word, SearchKind kind, std::size_t limit = 3) const;
+};
+
+
+// ". Did you mean km or mm?" for the nearest suggestions, or "" when there are none, to
+// follow a message about an unknown word
+std::string didYouMean(const std::vector<std::string_view>& suggestions);
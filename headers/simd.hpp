@@ -0,0 +1,149 @@
+// simd.hpp: Vectorised kernels for applying one conversion to arrays of values, and for
+// finding the separators of delimited text
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define UC_X86_SIMD 1
+#endif
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+
+// The affine kernels multiply and then add, and must not be contracted into fused
+// multiply-adds, which round once instead of twice: GCC contracts by default wherever the
+// target has FMA, as avx512f does, and Clang within an expression.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC push_options
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+
+// Writes out[i] = in[i] * scale + offset. Every path multiplies and then adds, without
+// fusing, so the vector paths give the same bits as the scalar loop.
+inline void affineScalar(const double* in, double* out, std::size_t n, double scale, double offset) {
+#ifdef __clang__
+#pragma clang fp contract(off)
+#endif
+    for (std::size_t i = 0; i < n; ++i)
+        out[i] = in[i] * scale + offset;
+}
+
+
+#ifdef UC_X86_SIMD
+__attribute__((target("avx2")))
+inline void affineAvx2(const double* in, double* out, std::size_t n, double scale, double offset) {
+    const __m256d s = _mm256_set1_pd(scale);
+    const __m256d o = _mm256_set1_pd(offset);
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256d a = _mm256_loadu_pd(in + i);
+        __m256d b = _mm256_loadu_pd(in + i + 4);
+        _mm256_storeu_pd(out + i, _mm256_add_pd(_mm256_mul_pd(a, s), o));
+        _mm256_storeu_pd(out + i + 4, _mm256_add_pd(_mm256_mul_pd(b, s), o));
+    }
+    affineScalar(in + i, out + i, n - i, scale, offset);
+}
+
+
+__attribute__((target("avx512f")))
+inline void affineAvx512(const double* in, double* out, std::size_t n, double scale, double offset) {
+    const __m512d s = _mm512_set1_pd(scale);
+    const __m512d o = _mm512_set1_pd(offset);
+    std::size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512d a = _mm512_loadu_pd(in + i);
+        __m512d b = _mm512_loadu_pd(in + i + 8);
+        _mm512_storeu_pd(out + i, _mm512_add_pd(_mm512_mul_pd(a, s), o));
+        _mm512_storeu_pd(out + i + 8, _mm512_add_pd(_mm512_mul_pd(b, s), o));
+    }
+    affineScalar(in + i, out + i, n - i, scale, offset);
+}
+#endif
+
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC pop_options
+#endif
+
+
+// Applies the affine map with the widest instructions the CPU supports. Other targets
+// use the scalar loop, which the compiler vectorises at -O3 (e.g. NEON on arm64).
+inline void affineTransform(const double* in, double* out, std::size_t n, double scale, double offset) {
+#ifdef UC_X86_SIMD
+    static const int level = __builtin_cpu_supports("avx512f") ? 2 : __builtin_cpu_supports("avx2") ? 1 : 0;
+    if (level == 2)
+        return affineAvx512(in, out, n, scale, offset);
+    if (level == 1)
+        return affineAvx2(in, out, n, scale, offset);
+#endif
+    affineScalar(in, out, n, scale, offset);
+}
+
+
+// Finds the positions of three bytes in text, such as a field delimiter, newline and
+// quote, in order. Each 64-byte block is compared once into a bit mask, 16 bytes at a
+// time with SSE2 (part of every x86-64 CPU) and byte by byte elsewhere, so that short
+// fields cost a bit scan rather than a search each.
+class ByteScanner {
+    private:
+        const char* begin;
+        const char* end;
+        char a, b, c;
+        // The block being scanned, and the positions in it not yet returned
+        const char* block;
+        std::uint64_t mask = 0;
+
+        void load() {
+            mask = 0;
+            std::size_t size = static_cast<std::size_t>(end - block) < 64 ? static_cast<std::size_t>(end - block) : 64;
+            std::size_t i = 0;
+#if defined(__SSE2__)
+            const __m128i va = _mm_set1_epi8(a), vb = _mm_set1_epi8(b), vc = _mm_set1_epi8(c);
+            for (; i + 16 <= size; i += 16) {
+                __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + i));
+                __m128i found = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(bytes, va), _mm_cmpeq_epi8(bytes, vb)),
+                                             _mm_cmpeq_epi8(bytes, vc));
+                mask |= static_cast<std::uint64_t>(static_cast<unsigned>(_mm_movemask_epi8(found))) << i;
+            }
+#endif
+            for (; i < size; ++i) {
+                if (block[i] == a || block[i] == b || block[i] == c)
+                    mask |= std::uint64_t(1) << i;
+            }
+        }
+
+    public:
+        ByteScanner(std::string_view text, char a, char b, char c)
+            : begin(text.data()), end(text.data() + text.size()), a(a), b(b), c(c), block(text.data()) {
+            if (begin != end)
+                load();
+        }
+
+        // The first of the bytes at or after from, or the end of the text
+        const char* next(const char* from) {
+            if (from >= end)
+                return end;
+            if (from < block || from - block >= 64) {
+                block = begin + (from - begin) / 64 * 64;
+                load();
+            }
+            std::size_t skipped = static_cast<std::size_t>(from - block);
+            std::uint64_t ahead = skipped == 0 ? mask : mask & (~std::uint64_t(0) << skipped);
+            while (ahead == 0) {
+                if (end - block <= 64)
+                    return end;
+                block += 64;
+                load();
+                ahead = mask;
+            }
+            return block + std::countr_zero(ahead);
+        }
+};
@@ -0,0 +1,145 @@
+// stats.hpp: Optional counters and latency histograms for the hot paths, shown by --stats.
+// Compiled in only when UC_STATS is defined (UC_STATS=1 ./build_main.sh); otherwise
+// UC_STATS_SCOPE expands to nothing and instrumented code is unchanged.
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <format>
+#include <string>
+#include <string_view>
+
+#ifdef UC_STATS
+#include <atomic>
+#include <bit>
+#include <chrono>
+#endif
+
+
+// Parts of uc that are timed
+enum class Stage {
+    // Numbers and unit expressions read from input
+    Parse,
+    // Unit lookups by symbol or name
+    Lookup,
+    // Conversions of single values and of arrays
+    Convert,
+    // Numbers written to output
+    Format,
+    // Appends to the conversion history
+    History,
+    // Unit and constant tables loaded
+    Load
+};
+
+inline constexpr std::size_t stageCount = 6;
+inline constexpr std::array<std::string_view, stageCount> stageNames = { "parse", "lookup", "convert", "format",
+                                                                         "history", "load" };
+
+#ifdef UC_STATS
+inline constexpr bool statsEnabled = true;
+#else
+inline constexpr bool statsEnabled = false;
+#endif
+
+
+#ifdef UC_STATS
+namespace stats {
+    // Latencies are kept in power-of-two buckets of nanoseconds: bucket b counts those
+    // from 2^b up to 2^(b+1)
+    inline constexpr std::size_t bucketCount = 64;
+
+    struct StageStats {
+        std::atomic<std::uint64_t> count = 0;
+        std::atomic<std::uint64_t> totalNanoseconds = 0;
+        std::atomic<std::uint64_t> maxNanoseconds = 0;
+        std::array<std::atomic<std::uint64_t>, bucketCount> buckets{};
+    };
+
+    inline std::array<StageStats, stageCount> stages;
+
+    // Safe to call from any thread; counters are relaxed, as they are only read for reports
+    inline void record(Stage stage, std::uint64_t nanoseconds) noexcept {
+        StageStats& s = stages[static_cast<std::size_t>(stage)];
+        s.count.fetch_add(1, std::memory_order_relaxed);
+        s.totalNanoseconds.fetch_add(nanoseconds, std::memory_order_relaxed);
+        s.buckets[static_cast<std::size_t>(std::bit_width(nanoseconds | 1) - 1)].fetch_add(1, std::memory_order_relaxed);
+        std::uint64_t max = s.maxNanoseconds.load(std::memory_order_relaxed);
+        while (nanoseconds > max && !s.maxNanoseconds.compare_exchange_weak(max, nanoseconds, std::memory_order_relaxed)) {
+        }
+    }
+
+    // Records the time from its construction to its destruction against a stage
+    class Timer {
+        private:
+            Stage stage;
+            std::chrono::steady_clock::time_point start;
+
+        public:
+            explicit Timer(Stage stage) noexcept : stage(stage), start(std::chrono::steady_clock::now()) {}
+
+            Timer(const Timer&) = delete;
+            Timer& operator=(const Timer&) = delete;
+
+            ~Timer() {
+                auto elapsed = std::chrono::steady_clock::now() - start;
+                record(stage, static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+            }
+    };
+}
+
+#define UC_STATS_NAME2(line) statsTimer##line
+#define UC_STATS_NAME(line) UC_STATS_NAME2(line)
+// Times the rest of the enclosing scope against stage
+#define UC_STATS_SCOPE(stage) const ::stats::Timer UC_STATS_NAME(__LINE__)(stage)
+#else
+#define UC_STATS_SCOPE(stage) static_cast<void>(0)
+#endif
+
+
+// Appends a table of each stage's count and latencies to out, or a note that uc was built
+// without statistics. Percentiles are the upper bounds of their histogram buckets.
+inline void appendStats(std::string& out) {
+#ifdef UC_STATS
+    out += std::format("{:<10}{:>12}{:>14}{:>12}{:>12}{:>12}{:>12}\n", "stage", "count", "total ms", "mean us",
+                       "p50 us", "p99 us", "max us");
+    for (std::size_t i = 0; i < stageCount; ++i) {
+        const stats::StageStats& s = stats::stages[i];
+        std::uint64_t count = s.count.load(std::memory_order_relaxed);
+        if (count == 0)
+            continue;
+        std::uint64_t max = s.maxNanoseconds.load(std::memory_order_relaxed);
+        auto percentile = [&](double fraction) {
+            std::uint64_t seen = 0;
+            for (std::size_t b = 0; b < stats::bucketCount; ++b) {
+                seen += s.buckets[b].load(std::memory_order_relaxed);
+                if (static_cast<double>(seen) >= fraction * static_cast<double>(count))
+                    return static_cast<double>(std::min(std::uint64_t(2) << b, max)) / 1e3;
+            }
+            return static_cast<double>(max) / 1e3;
+        };
+        double total = static_cast<double>(s.totalNanoseconds.load(std::memory_order_relaxed));
+        out += std::format("{:<10}{:>12}{:>14.3f}{:>12.3f}{:>12.3f}{:>12.3f}{:>12.3f}\n", stageNames[i], count, total / 1e6,
+                           total / static_cast<double>(count) / 1e3, percentile(0.5), percentile(0.99),
+                           static_cast<double>(max) / 1e3);
+    }
+#else
+    out += "Statistics are not compiled in; build with UC_STATS=1 to enable them.\n";
+#endif
+}
+
+
+// Clears every counter, as at start-up
+inline void resetStats() {
+#ifdef UC_STATS
+    for (stats::StageStats& s: stats::stages) {
+        s.count = 0;
+        s.totalNanoseconds = 0;
+        s.maxNanoseconds = 0;
+        for (std::atomic<std::uint64_t>& bucket: s.buckets)
+            bucket = 0;
+    }
+#endif
+}
@@ -0,0 +1,547 @@
+// tables.hpp: Unit and constant tables, their hash indexes and conversion matrices,
+// parsed and built during compilation
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "rational.hpp"
+
+using UnitId = std::uint32_t;
+inline constexpr UnitId unknownUnit = std::numeric_limits<UnitId>::max();
+
+
+inline constexpr std::string_view listOfUnits = R"(DATA        Bit                 b       Bit            1
+DATA        Byte                B       Bit            8
+DATA        Kilobit             kbit    Bit            1000
+DATA        Kibibit             Kib     Bit            1024
+DATA        Kilobyte            KB      Bit            8000
+DATA        Kibibyte            KiB     Bit            8192
+DATA        Megabit             Mbit    Bit            1000000
+DATA        Mebibit             Mib     Bit            1048576
+DATA        Megabyte            MB      Bit            8000000
+DATA        Mebibyte            MiB     Bit            8388608
+DATA        Gigabit             Gbit    Bit            1000000000
+DATA        Gibibit             Gib     Bit            1073741824
+DATA        Gigabyte            GB      Bit            8000000000
+DATA        Gibibyte            GiB     Bit            8589934592
+DATA        Terabit             Tbit    Bit            1000000000000
+DATA        Tebibit             Tib     Bit            1099511627776
+DATA        Terabyte            TB      Bit            8000000000000
+DATA        Tebibyte            TiB     Bit            8796093022208
+DISTANCE    Meter               m       Meter          1
+DISTANCE    Kilometer           km      Meter          1000
+DISTANCE    Centimeter          cm      Meter          0.01
+DISTANCE    Millimeter          mm      Meter          0.001
+DISTANCE    Micrometer          μm     Meter          0.000001
+DISTANCE    Nanometer           nm      Meter          0.000000001
+DISTANCE    Inch                in      Meter          0.0254
+DISTANCE    Foot                ft      Meter          0.3048
+DISTANCE    Yard                yd      Meter          0.9144
+DISTANCE    Fathom              fth     Meter          1.829
+DISTANCE    Furlong             fur     Meter          201.68
+DISTANCE    Mile                mi      Meter          1609.34
+DISTANCE    Nautical Mile       nmi     Meter          1852
+VOLUME      Liter               l       Liter          1
+VOLUME      Milliliter          ml      Liter          0.001
+VOLUME      Cubic meter         m^3     Liter          1000
+VOLUME      Cubic centimeter    cc      Liter          0.001
+VOLUME      Gallon              gal     Liter          3.78541
+VOLUME      Quart               qt      Liter          0.946353
+VOLUME      Pint                pt      Liter          0.473176
+VOLUME      Fluid ounce         fl oz   Liter          0.0295735
+AREA        Square meter        m^2     Square meter   1
+AREA        Square kilometer    km^2    Square meter   1000000
+AREA        Square centimeter   cm^2    Square meter   0.0001
+AREA        Square millimeter   mm^2    Square meter   0.000001
+AREA        Hectare             ha      Square meter   10000
+AREA        Acre                ac      Square meter   4046.86
+AREA        Square inch         in^2    Square meter   0.00064516
+AREA        Square foot         ft^2    Square meter   0.092903
+AREA        Square yard         yd^2    Square meter   0.836127
+AREA        Square mile         mi^2    Square meter   2589988
+MASS        Kilogram            kg      Kilogram       1
+MASS        Gram                g       Kilogram       0.001
+MASS        Milligram           mg      Kilogram       0.000001
+MASS        Metric ton          t       Kilogram       1000
+MASS        Pound               lb      Kilogram       0.453592
+MASS        Ounce               oz      Kilogram       0.0283495
+MASS        Stone               st      Kilogram       6.35029
+TIME        Second              s       Second         1
+TIME        Minute              min     Second         60
+TIME        Hour                h       Second         3600
+TIME        Day                 d       Second         86400
+TIME        Week                wk      Second         604800
+TIME        Month               mo      Second         2629800
+TIME        Year                yr      Second         31557600
+TEMPERATURE celsius             C       Celsius        1
+TEMPERATURE fahrenheit          F       Celsius        1
+TEMPERATURE kelvin              K       Celsius        1)";
+
+
+inline constexpr std::string_view listOfConstants = R"(MATHEMATICS     Pi                             pi          3.141592653589793   -
+MATHEMATICS     Eulers Number                  e           2.718281828459045   -
+MATHEMATICS     Golden Ratio                   phi         1.618033988749895   -
+MATHEMATICS     Square Root of 2               root2       1.414213562373095   -
+MATHEMATICS     Square Root of 3               root3       1.732050807568877   -
+MATHEMATICS     Square Root of 5               root5       2.236067977499790   -
+MATHEMATICS     Natural Logarithm of 2         ln(2)       0.693147180559945   -
+MATHEMATICS     Euler-Mascheroni Constant      y           0.577215664901533   -
+MATHEMATICS     Ramanujan-Soldner Constant     -           1.451369234883381   -
+MATHEMATICS     Khinchins Constant             K           2.685452001065306   -
+MATHEMATICS     Glaisher-Kinkelin Constant     A           1.282427129100623   -
+PHYSICS         Speed of Light in Vacuum       c           299792458           m/s
+PHYSICS         Gravitational Constant         G           6.67430e-11         m^3/(kg*s^2)
+PHYSICS         Plancks Constant               h           6.62607015e-34      J*s
+PHYSICS         Reduced Plancks Constant       ħ           1.054571817e-34     J*s
+PHYSICS         Elementary Charge              e           1.602176634e-19     C
+PHYSICS         Electron Rest Mass             -           9.1093837015e-31    kg
+PHYSICS         Proton Rest Mass               -           1.67262192369e-27   kg
+PHYSICS         Fine-Structure Constant        -           7.2973525693e-3     -
+PHYSICS         Rydberg Constant               -           10973731.568160     m^-1
+PHYSICS         Avogadros Number               NA          6.02214076e23       mol^-1
+PHYSICS         Boltzmann Constant             kB          1.380649e-23        J/K
+PHYSICS         Stefan-Boltzmann Constant      -           5.670374419e-8      W/(m^2*K^4)
+PHYSICS         Vacuum Permeability            -           1.25663706212e-6    N/A^2
+PHYSICS         Vacuum Permittivity            -           8.8541878128e-12    F/m
+CHEMISTRY       Atomic Mass Unit               u           1.66053906660e-27   kg
+CHEMISTRY       Faraday Constant               F           96485.33212         C/mol
+CHEMISTRY       Molar Gas Constant             R           8.314462618         J/(mol*K)
+CHEMISTRY       First Radiation Constant       c1          3.741771852e-16     W*m^2
+CHEMISTRY       Second Radiation Constant      c2          1.438776877e-2      m*K)";
+
+
+// Slot of an open-addressed hash index mapping a unit or constant symbol/name to
+// its position in the owning table. Keys view strings owned by that table.
+struct IndexSlot {
+    std::string_view key;
+    UnitId id = unknownUnit;
+};
+
+
+constexpr char foldChar(char c) {
+    return c >= 'a' && c <= 'z' ? static_cast<char>(c - 'a' + 'A') : c;
+}
+
+
+// FNV-1a, optionally over ASCII upper case so that names match case agnostically
+constexpr std::uint64_t hashKey(std::string_view key, bool foldCase) {
+    std::uint64_t hash = 14695981039346656037ull;
+    for (char c: key) {
+        hash ^= static_cast<unsigned char>(foldCase ? foldChar(c) : c);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+
+constexpr bool keysEqual(std::string_view a, std::string_view b, bool foldCase) {
+    if (a.size() != b.size())
+        return false;
+    for (std::size_t i = 0; i < a.size(); ++i) {
+        if ((foldCase ? foldChar(a[i]) : a[i]) != (foldCase ? foldChar(b[i]) : b[i]))
+            return false;
+    }
+    return true;
+}
+
+
+// Number of slots for an index of n keys: a power of two at most half full
+constexpr std::size_t indexCapacity(std::size_t n) {
+    std::size_t capacity = 8;
+    while (capacity < 2 * n)
+        capacity *= 2;
+    return capacity;
+}
+
+
+// Inserts key, replacing the id of an equal key already present
+constexpr void insertKey(std::span<IndexSlot> slots, std::string_view key, UnitId id, bool foldCase) {
+    std::size_t mask = slots.size() - 1;
+    for (std::size_t i = hashKey(key, foldCase) & mask;; i = (i + 1) & mask) {
+        if (slots[i].id == unknownUnit || keysEqual(slots[i].key, key, foldCase)) {
+            slots[i] = { key, id };
+            return;
+        }
+    }
+}
+
+
+constexpr UnitId findKey(std::span<const IndexSlot> slots, std::string_view key, bool foldCase) {
+    if (slots.empty())
+        return unknownUnit;
+    std::size_t mask = slots.size() - 1;
+    for (std::size_t i = hashKey(key, foldCase) & mask;; i = (i + 1) & mask) {
+        if (slots[i].id == unknownUnit)
+            return unknownUnit;
+        if (keysEqual(slots[i].key, key, foldCase))
+            return slots[i].id;
+    }
+}
+
+
+// A row of listOfUnits. Fields view the table text, which must outlive the record.
+struct UnitRecord {
+    std::string_view category;
+    std::string_view name;
+    std::string_view symbol;
+    std::string_view baseUnit;
+    double conversionFactor;
+    // The factor as written, exactly; den is 0 when its digits do not fit in 64 bits
+    Rational exactFactor;
+};
+
+
+// A row of listOfConstants. Fields view the table text, which must outlive the record.
+struct ConstantRecord {
+    std::string_view group;
+    std::string_view name;
+    std::string_view symbol;
+    std::string_view value;
+    std::string_view unit;
+};
+
+
+// Rows of a table with their symbol and name indexes
+template <class Record>
+struct Table {
+    std::span<const Record> records;
+    std::span<const IndexSlot> symbolIndex;
+    std::span<const IndexSlot> nameIndex;
+};
+
+
+// Returns the fixed-width field at pos, without trailing whitespace
+constexpr std::string_view field(std::string_view line, std::size_t pos, std::size_t width) {
+    if (pos >= line.size())
+        return {};
+    std::string_view text = line.substr(pos, width);
+    std::size_t last = text.find_last_not_of(" \t\r");
+    return last == std::string_view::npos ? std::string_view() : text.substr(0, last + 1);
+}
+
+
+// Parses a decimal such as 0.0254 or 6.67430e-11. The result is correctly rounded when
+// the digits fit in 53 bits and the exponent is within 22, as for every listOfUnits factor.
+constexpr double parseDecimal(std::string_view text) {
+    std::size_t i = 0;
+    bool negative = !text.empty() && text[0] == '-';
+    if (!text.empty() && (text[0] == '-' || text[0] == '+'))
+        ++i;
+
+    double mantissa = 0;
+    int exponent = 0;
+    bool digits = false;
+    for (bool fraction = false; i < text.size(); ++i) {
+        if (text[i] >= '0' && text[i] <= '9') {
+            mantissa = mantissa * 10 + (text[i] - '0');
+            exponent -= fraction ? 1 : 0;
+            digits = true;
+        } else if (text[i] == '.' && !fraction) {
+            fraction = true;
+        } else {
+            break;
+        }
+    }
+
+    if (i < text.size() && (text[i] == 'e' || text[i] == 'E')) {
+        bool negativeExponent = i + 1 < text.size() && text[i + 1] == '-';
+        i += i + 1 < text.size() && (text[i + 1] == '-' || text[i + 1] == '+') ? 2 : 1;
+        int value = 0;
+        bool exponentDigits = false;
+        for (; i < text.size() && text[i] >= '0' && text[i] <= '9'; ++i) {
+            value = value * 10 + (text[i] - '0');
+            exponentDigits = true;
+        }
+        digits = digits && exponentDigits;
+        exponent += negativeExponent ? -value : value;
+    }
+
+    if (!digits || i != text.size())
+        throw std::invalid_argument("Invalid number in table");
+
+    // Powers of ten up to 1e22 are exact, so each step rounds at most once
+    double scale = 1;
+    for (int e = exponent < 0 ? -exponent : exponent; e > 0; --e)
+        scale *= 10;
+    double value = exponent < 0 ? mantissa / scale : mantissa * scale;
+    return negative ? -value : value;
+}
+
+
+// Calls parse with each non-empty line of a table
+template <class Parse>
+constexpr void forEachRow(std::string_view table, Parse parse) {
+    while (!table.empty()) {
+        std::size_t end = std::min(table.find('\n'), table.size());
+        if (end > 0)
+            parse(table.substr(0, end));
+        table.remove_prefix(std::min(end + 1, table.size()));
+    }
+}
+
+
+constexpr std::size_t countRows(std::string_view table) {
+    std::size_t rows = 0;
+    forEachRow(table, [&](std::string_view) { ++rows; });
+    return rows;
+}
+
+
+constexpr UnitRecord parseUnitRow(std::string_view line) {
+    return { .category=field(line, 0, 12), .name=field(line, 12, 20), .symbol=field(line, 32, 8),
+             .baseUnit=field(line, 40, 15), .conversionFactor=parseDecimal(field(line, 55, 20)),
+             .exactFactor=parseRational(field(line, 55, 20)).value_or(Rational{ 0, 0 }) };
+}
+
+
+constexpr ConstantRecord parseConstantRow(std::string_view line) {
+    return { .group=field(line, 0, 16), .name=field(line, 16, 31), .symbol=field(line, 47, 12),
+             .value=field(line, 59, 20), .unit=field(line, 79, 20) };
+}
+
+
+template <class Record, std::size_t N, class Parse>
+constexpr std::array<Record, N> parseTable(std::string_view table, Parse parse) {
+    std::array<Record, N> records{};
+    std::size_t row = 0;
+    forEachRow(table, [&](std::string_view line) { records[row++] = parse(line); });
+    return records;
+}
+
+
+// Indexes records by one of their fields, numbering them from firstId. A later record
+// replaces an earlier one with the same key unless firstWins is set; the key "-" marks
+// a record without one.
+template <class Record>
+constexpr void fillIndex(std::span<IndexSlot> slots, std::span<const Record> records,
+                         std::string_view Record::*key, bool foldCase, bool firstWins, UnitId firstId = 0) {
+    for (std::size_t i = 0; i < records.size(); ++i) {
+        std::size_t row = firstWins ? records.size() - 1 - i : i;
+        if (records[row].*key != "-")
+            insertKey(slots, records[row].*key, firstId + static_cast<UnitId>(row), foldCase);
+    }
+}
+
+
+template <std::size_t Capacity, class Record, std::size_t N>
+constexpr std::array<IndexSlot, Capacity> buildIndex(const std::array<Record, N>& records,
+                                                     std::string_view Record::*key, bool foldCase, bool firstWins) {
+    // Filled explicitly: GCC 12 drops IndexSlot's default member initialisers when
+    // value-initialising a large array during constant evaluation
+    std::array<IndexSlot, Capacity> slots;
+    slots.fill(IndexSlot{ std::string_view(), unknownUnit });
+    fillIndex<Record>(slots, records, key, foldCase, firstWins);
+    return slots;
+}
+
+
+// An affine map between two units: result = amount * scale + offset. The offset is
+// zero except between temperature scales.
+struct Conversion {
+    double scale = 1;
+    double offset = 0;
+};
+
+
+// Conversion of a temperature unit to Kelvin
+constexpr Conversion kelvinConversion(std::string_view symbol) {
+    const double ABSOLUTE_ZERO_C = -273.15;
+    const double ABSOLUTE_ZERO_F = -459.67;
+
+    if (symbol == "C")
+        return { 1.0, -ABSOLUTE_ZERO_C };
+    if (symbol == "F")
+        return { 5.0 / 9.0, -ABSOLUTE_ZERO_F * 5.0 / 9.0 };
+    if (symbol == "K")
+        return { 1.0, 0.0 };
+    throw std::invalid_argument("Unknown temperature unit");
+}
+
+
+// Conversion of a unit to the base unit of its category
+constexpr Conversion baseConversion(const UnitRecord& unit) {
+    if (unit.category == "TEMPERATURE")
+        return kelvinConversion(unit.symbol);
+    return { unit.conversionFactor, 0.0 };
+}
+
+
+// Conversion from one unit to another of the same category, via their base unit
+constexpr Conversion composeConversion(const Conversion& from, const Conversion& to) {
+    return { from.scale / to.scale, (from.offset - to.offset) / to.scale };
+}
+
+
+// As kelvinConversion, exactly
+constexpr ExactConversion exactKelvinConversion(std::string_view symbol) {
+    if (symbol == "C")
+        return { { 1, 1 }, { 5463, 20 } };
+    if (symbol == "F")
+        return { { 5, 9 }, { 45967, 180 } };
+    if (symbol == "K")
+        return { { 1, 1 }, { 0, 1 } };
+    throw std::invalid_argument("Unknown temperature unit");
+}
+
+
+// As baseConversion, exactly, or nullopt for a factor without an exact value
+constexpr std::optional<ExactConversion> exactBaseConversion(const UnitRecord& unit) {
+    if (unit.category == "TEMPERATURE")
+        return exactKelvinConversion(unit.symbol);
+    if (unit.exactFactor.den == 0)
+        return std::nullopt;
+    return ExactConversion{ unit.exactFactor, { 0, 1 } };
+}
+
+
+// As composeConversion, exactly, or nullopt on overflow
+constexpr std::optional<ExactConversion> composeExactConversion(const ExactConversion& from, const ExactConversion& to) {
+    std::optional<Rational> scale = from.scale / to.scale;
+    std::optional<Rational> difference = from.offset - to.offset;
+    std::optional<Rational> offset = difference ? *difference / to.scale : std::nullopt;
+    if (!scale || !offset)
+        return std::nullopt;
+    return ExactConversion{ *scale, *offset };
+}
+
+
+// Categories with more units than this compose conversions from baseConversion on each
+// call rather than storing a dense matrix that grows with the square of their size.
+inline constexpr std::uint32_t maxMatrixUnits = 256;
+inline constexpr std::uint32_t noMatrix = std::numeric_limits<std::uint32_t>::max();
+
+
+// Units numbered by category, with a dense from-to matrix of conversions per category.
+// The conversion between units a and b of category c is
+// matrix[matrixStart[c] + position[a] * categorySize[c] + position[b]].
+struct FactorMatrix {
+    std::span<const std::uint32_t> categoryOf;
+    std::span<const std::uint32_t> position;
+    std::span<const std::uint32_t> categorySize;
+    std::span<const std::uint32_t> matrixStart;
+    std::span<const Conversion> matrix;
+};
+
+
+// Interns one field of a table's records, such as unit categories or constant groups,
+// numbering its values in order of first appearance: ids[i] is the number of
+// records[i].*key. Returns the number of distinct values.
+template <class Record>
+constexpr std::uint32_t numberKeys(std::span<const Record> records, std::string_view Record::*key, std::span<std::uint32_t> ids) {
+    // Filled explicitly: see buildIndex
+    std::vector<IndexSlot> slots(indexCapacity(records.size()), IndexSlot{ std::string_view(), unknownUnit });
+    std::uint32_t count = 0;
+    for (std::size_t i = 0; i < records.size(); ++i) {
+        UnitId id = findKey(slots, records[i].*key, false);
+        if (id == unknownUnit) {
+            id = count++;
+            insertKey(slots, records[i].*key, id, false);
+        }
+        ids[i] = id;
+    }
+    return count;
+}
+
+
+// Numbers the categories of a table in order of first appearance: categoryOf[i] is the
+// category of records[i]. Returns the number of categories.
+constexpr std::uint32_t numberCategories(std::span<const UnitRecord> records, std::span<std::uint32_t> categoryOf) {
+    return numberKeys<UnitRecord>(records, &UnitRecord::category, categoryOf);
+}
+
+
+// Number of categories and of matrix entries needed for a table
+constexpr std::pair<std::size_t, std::size_t> factorMatrixSize(std::span<const UnitRecord> records) {
+    std::vector<std::uint32_t> categoryOf(records.size());
+    std::vector<std::size_t> sizes(numberCategories(records, categoryOf));
+    for (std::uint32_t category: categoryOf)
+        ++sizes[category];
+    std::size_t entries = 0;
+    for (std::size_t size: sizes)
+        entries += size <= maxMatrixUnits ? size * size : 0;
+    return { sizes.size(), entries };
+}
+
+
+// Fills spans sized by factorMatrixSize. Categories are numbered in table order. Takes
+// time linear in the table plus the matrix entries, so large catalogues load quickly.
+constexpr void fillFactorMatrix(std::span<const UnitRecord> records, std::span<std::uint32_t> categoryOf,
+                                std::span<std::uint32_t> position, std::span<std::uint32_t> categorySize,
+                                std::span<std::uint32_t> matrixStart, std::span<Conversion> matrix) {
+    std::uint32_t categories = numberCategories(records, categoryOf);
+    std::fill(categorySize.begin(), categorySize.end(), 0u);
+    for (std::size_t i = 0; i < records.size(); ++i)
+        position[i] = categorySize[categoryOf[i]]++;
+
+    // Records grouped by category, each group in table order
+    std::vector<std::size_t> groupStart(categories + 1, 0);
+    for (std::uint32_t category = 0; category < categories; ++category)
+        groupStart[category + 1] = groupStart[category] + categorySize[category];
+    std::vector<std::size_t> grouped(records.size());
+    std::vector<Conversion> base(records.size());
+    for (std::size_t i = 0; i < records.size(); ++i) {
+        grouped[groupStart[categoryOf[i]] + position[i]] = i;
+        base[i] = baseConversion(records[i]);
+    }
+
+    std::uint32_t start = 0;
+    for (std::uint32_t category = 0; category < categories; ++category) {
+        std::uint32_t size = categorySize[category];
+        matrixStart[category] = size <= maxMatrixUnits ? start : noMatrix;
+        if (size > maxMatrixUnits)
+            continue;
+        for (std::uint32_t from = 0; from < size; ++from) {
+            for (std::uint32_t to = 0; to < size; ++to) {
+                matrix[start + from * size + to] = composeConversion(base[grouped[groupStart[category] + from]],
+                                                                     base[grouped[groupStart[category] + to]]);
+            }
+        }
+        start += size * size;
+    }
+}
+
+
+template <std::size_t Units, std::size_t Categories, std::size_t Entries>
+struct FactorStorage {
+    std::array<std::uint32_t, Units> categoryOf{};
+    std::array<std::uint32_t, Units> position{};
+    std::array<std::uint32_t, Categories> categorySize{};
+    std::array<std::uint32_t, Categories> matrixStart{};
+    std::array<Conversion, Entries> matrix{};
+};
+
+
+template <std::size_t Categories, std::size_t Entries, std::size_t N>
+constexpr FactorStorage<N, Categories, Entries> buildFactorMatrix(const std::array<UnitRecord, N>& records) {
+    FactorStorage<N, Categories, Entries> storage;
+    fillFactorMatrix(records, storage.categoryOf, storage.position, storage.categorySize, storage.matrixStart, storage.matrix);
+    return storage;
+}
+
+
+// The built-in tables, parsed and indexed during compilation. Symbols match exactly and
+// names case agnostically. Later units win a shared key, earlier constants do (e.g. e).
+inline constexpr auto builtinUnitRecords = parseTable<UnitRecord, countRows(listOfUnits)>(listOfUnits, parseUnitRow);
+inline constexpr auto builtinUnitSymbols = buildIndex<indexCapacity(builtinUnitRecords.size())>(builtinUnitRecords, &UnitRecord::symbol, false, false);
+inline constexpr auto builtinUnitNames = buildIndex<indexCapacity(builtinUnitRecords.size())>(builtinUnitRecords, &UnitRecord::name, true, false);
+inline constexpr Table<UnitRecord> builtinUnits = { builtinUnitRecords, builtinUnitSymbols, builtinUnitNames };
+inline constexpr auto builtinFactorStorage = buildFactorMatrix<factorMatrixSize(builtinUnitRecords).first,
+                                                        factorMatrixSize(builtinUnitRecords).second>(builtinUnitRecords);
+inline constexpr FactorMatrix builtinFactors = { builtinFactorStorage.categoryOf, builtinFactorStorage.position,
+                                          builtinFactorStorage.categorySize, builtinFactorStorage.matrixStart,
+                                          builtinFactorStorage.matrix };
+
+inline constexpr auto builtinConstantRecords = parseTable<ConstantRecord, countRows(listOfConstants)>(listOfConstants, parseConstantRow);
+inline constexpr auto builtinConstantSymbols = buildIndex<indexCapacity(builtinConstantRecords.size())>(builtinConstantRecords, &ConstantRecord::symbol, false, true);
+inline constexpr auto builtinConstantNames = buildIndex<indexCapacity(builtinConstantRecords.size())>(builtinConstantRecords, &ConstantRecord::name, true, true);
+inline constexpr Table<ConstantRecord> builtinConstants = { builtinConstantRecords, builtinConstantSymbols, builtinConstantNames };
@@ -0,0 +1,125 @@
+// thread_pool.hpp: Work-stealing thread pool for parallel batch conversion
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+// Runs submitted tasks on a fixed set of threads. Each thread has its own queue and
+// takes its newest task first; an idle thread steals the oldest task of another queue.
+class WorkStealingPool {
+    private:
+        struct Queue {
+            std::mutex mutex;
+            std::deque<std::function<void()>> tasks;
+        };
+
+        std::vector<std::unique_ptr<Queue>> queues;
+        std::vector<std::thread> workers;
+
+        std::mutex stateMutex;
+        std::condition_variable wake;
+        std::condition_variable idle;
+        std::size_t queued = 0;
+        std::size_t pending = 0;
+        std::size_t nextQueue = 0;
+        bool stopping = false;
+
+        bool take(std::size_t self, std::function<void()>& task) {
+            for (std::size_t i = 0; i < queues.size(); ++i) {
+                Queue& queue = *queues[(self + i) % queues.size()];
+                std::lock_guard<std::mutex> lock(queue.mutex);
+                if (queue.tasks.empty())
+                    continue;
+                if (i == 0) {
+                    task = std::move(queue.tasks.back());
+                    queue.tasks.pop_back();
+                } else {
+                    task = std::move(queue.tasks.front());
+                    queue.tasks.pop_front();
+                }
+                return true;
+            }
+            return false;
+        }
+
+        void work(std::size_t self) {
+            while (true) {
+                std::function<void()> task;
+                if (take(self, task)) {
+                    {
+                        std::lock_guard<std::mutex> lock(stateMutex);
+                        --queued;
+                    }
+                    task();
+                    std::lock_guard<std::mutex> lock(stateMutex);
+                    if (--pending == 0)
+                        idle.notify_all();
+                    continue;
+                }
+
+                std::unique_lock<std::mutex> lock(stateMutex);
+                wake.wait(lock, [&]() { return stopping || queued > 0; });
+                if (stopping && queued == 0)
+                    return;
+            }
+        }
+
+    public:
+        // threads == 0 uses one thread per hardware thread
+        explicit WorkStealingPool(unsigned threads) {
+            if (threads == 0)
+                threads = std::max(1u, std::thread::hardware_concurrency());
+            for (unsigned i = 0; i < threads; ++i)
+                queues.push_back(std::make_unique<Queue>());
+            for (unsigned i = 0; i < threads; ++i)
+                workers.emplace_back(&WorkStealingPool::work, this, i);
+        }
+
+        ~WorkStealingPool() {
+            {
+                std::lock_guard<std::mutex> lock(stateMutex);
+                stopping = true;
+            }
+            wake.notify_all();
+            for (std::thread& worker: workers)
+                worker.join();
+        }
+
+        WorkStealingPool(const WorkStealingPool&) = delete;
+        WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+        std::size_t size() const {
+            return workers.size();
+        }
+
+        // Tasks must not throw: catch what they may throw, such as into an
+        // std::exception_ptr, and rethrow it on the submitting thread after wait
+        void submit(std::function<void()> task) {
+            std::size_t target;
+            {
+                std::lock_guard<std::mutex> lock(stateMutex);
+                target = nextQueue++ % queues.size();
+                ++queued;
+                ++pending;
+            }
+            {
+                std::lock_guard<std::mutex> lock(queues[target]->mutex);
+                queues[target]->tasks.push_back(std::move(task));
+            }
+            wake.notify_one();
+        }
+
+        // Blocks until every submitted task has finished
+        void wait() {
+            std::unique_lock<std::mutex> lock(stateMutex);
+            idle.wait(lock, [&]() { return pending == 0; });
+        }
+};
@@ -0,0 +1,217 @@
+// units.hpp: Unit conversion and constant lookup over the tables of tables.hpp
+#pragma once
+
+#include <cstdint>
+#include <expected>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "arena.hpp"
+#include "memo_cache.hpp"
+#include "plan_cache.hpp"
+#include "stats.hpp"
+#include "tables.hpp"
+
+
+namespace libuc {
+    enum class Error {
+        UnknownFromUnit,
+        UnknownToUnit,
+        IncompatibleUnits,
+        UnknownConstant,
+        InvalidValue,
+        NotExact
+    };
+
+    // A short description of error, for messages
+    std::string_view errorMessage(Error error) noexcept;
+}
+
+
+class Units {
+    private:
+        // Either a compile-time table such as builtinUnits, a snapshot, or the records,
+        // indexes and factor matrix of arena
+        Table<UnitRecord> table;
+        FactorMatrix factors;
+        // Shared by copies, as it is not changed once built
+        std::shared_ptr<const Arena> arena;
+        // Files and snapshots that the records or factors view
+        std::vector<std::shared_ptr<const void>> storage;
+        // Conversions compiled for unit expressions, cleared whenever units are loaded
+        mutable PlanCache<std::expected<Conversion, libuc::Error>> plans;
+        // Results of convert between plain units, when enabled with memoize
+        mutable MemoCache memo;
+
+    public:
+        // Uses a table and factor matrix built at compile time, such as builtinUnits and
+        // builtinFactors, in place. Tables that view other memory pass what keeps it alive.
+        void loadUnits(const Table<UnitRecord>& units, const FactorMatrix& unitFactors,
+                       std::shared_ptr<const void> keepAlive = nullptr);
+
+        // Parses a fixed-width table laid out like listOfUnits and adds its units to those
+        // already loaded, rebuilding the records, indexes and factor matrix in one arena.
+        // The text must outlive the Units.
+        void loadUnits(std::string_view lOU);
+
+        // As loadUnits(lOU), mapping the text from a file. Throws std::runtime_error if the
+        // file cannot be read and std::invalid_argument if it is not a unit table.
+        void loadUnitsFile(const std::string& path);
+
+        // Every loaded unit, in table order
+        std::span<const UnitRecord> units() const {
+            return table.records;
+        }
+
+        // The loaded records with their indexes, and their factor matrix
+        const Table<UnitRecord>& unitTable() const {
+            return table;
+        }
+
+        const FactorMatrix& unitFactors() const {
+            return factors;
+        }
+
+        // Returns the id of the unit with the given symbol or name, or unknownUnit.
+        // Units loaded later take precedence.
+        UnitId findUnit(std::string_view unit) const noexcept;
+
+        // True when both units belong to the same category
+        bool convertible(UnitId from, UnitId to) const noexcept {
+            return factors.categoryOf[from] == factors.categoryOf[to];
+        }
+
+        // Conversion between two convertible units. Batch callers look this up once and
+        // apply it to every value.
+        Conversion conversion(UnitId from, UnitId to) const noexcept;
+
+        // Converts every value of in into out, which must be the same size, using the
+        // vector kernels in simd.hpp. Throws std::invalid_argument for unknown or
+        // incompatible units.
+        void convertSpan(std::span<const double> in, std::span<double> out, UnitId from, UnitId to) const;
+
+        // As convertSpan, applying a conversion such as one returned by plan
+        void convertSpan(std::span<const double> in, std::span<double> out, const Conversion& c) const;
+
+        // Conversion from unitFrom to unitTo, each a unit or a compound expression such as
+        // km/h (see expressions.hpp), or why there is none. Pairs of plain units use the
+        // factor matrix; expressions are compiled once and cached.
+        std::expected<Conversion, libuc::Error> plan(std::string_view unitFrom, std::string_view unitTo) const;
+
+        // Returns amount converted from unitFrom to unitTo, or why it cannot be. Never
+        // throws, and only allocates to compile an expression not already cached.
+        std::expected<double, libuc::Error> convert(double amount, std::string_view unitFrom,
+                                                    std::string_view unitTo) const noexcept;
+
+        // Conversion between two units with the exact rational factors of their tables.
+        // Fails with Error::NotExact for expressions, and for factors or results whose
+        // numerators or denominators do not fit in 64 bits. Never allocates or throws.
+        std::expected<ExactConversion, libuc::Error> exactConversion(std::string_view unitFrom,
+                                                                     std::string_view unitTo) const noexcept;
+
+        // amount converted exactly, as for amounts of data that must not round. Integer
+        // amounts between units whose factors divide evenly, such as KiB to B, take a fast
+        // path of one checked multiply. Never allocates or throws.
+        std::expected<Rational, libuc::Error> convertExact(const Rational& amount, std::string_view unitFrom,
+                                                           std::string_view unitTo) const noexcept;
+
+        // As convert, in long double and from the exact factors where there are some. Where
+        // long double is double, as on 64-bit ARM, only the factors improve.
+        std::expected<long double, libuc::Error> convertExtended(long double amount, std::string_view unitFrom,
+                                                                 std::string_view unitTo) const noexcept;
+
+        // As convert, but throws std::invalid_argument with the user-facing message when a
+        // unit is unknown or the units are incompatible
+        double convertValue(double amount, std::string_view unitFrom, std::string_view unitTo) const;
+
+        // Remembers up to about capacity results of convert between plain units, keyed on
+        // their ids and the amount, for callers that convert the same values again and
+        // again; 0, the default, turns the memo off. Forgotten whenever units are loaded.
+        // Not safe while other threads convert.
+        void memoize(std::size_t capacity) {
+            memo.resize(capacity);
+        }
+
+        // Hits and misses of the memo since memoize or the last load
+        MemoStats memoStats() const noexcept {
+            return memo.stats();
+        }
+};
+
+
+class Constants {
+    private:
+        // Either a compile-time table such as builtinConstants, a snapshot, or the records
+        // and indexes of arena
+        Table<ConstantRecord> table;
+        // Columns beside the records: each constant's value as a number, NaN where the
+        // table's text is not one, and the number of its group, in order of first appearance
+        std::span<const double> values;
+        std::span<const std::uint32_t> groupOf;
+        std::uint32_t groupCount = 0;
+        // Holds the columns, and the records and indexes of tables loaded from text.
+        // Shared by copies, as it is not changed once built.
+        std::shared_ptr<const Arena> arena;
+        // End of the records of each table loaded, in load order
+        std::vector<std::size_t> tableEnds;
+        // Files and snapshots that the records view
+        std::vector<std::shared_ptr<const void>> storage;
+
+        // Bytes of arena taken by the columns of count constants
+        static std::size_t columnBytes(std::size_t count) {
+            return Arena::bytes<double>(count) + Arena::bytes<std::uint32_t>(count);
+        }
+
+        // Carves values and groupOf for the records of table from owned, and fills them
+        void fillColumns(Arena& owned);
+
+    public:
+        // Uses a table parsed and indexed at compile time, such as builtinConstants, in place.
+        // Tables that view other memory pass what keeps it alive.
+        void loadConstants(const Table<ConstantRecord>& constants, std::shared_ptr<const void> keepAlive = nullptr);
+
+        // Parses a fixed-width table laid out like listOfConstants and adds its constants to
+        // those already loaded, rebuilding the records, indexes and columns in one arena.
+        // The text must outlive the Constants.
+        void loadConstants(std::string_view lOC);
+
+        // As loadConstants(lOC), mapping the text from a file. Throws std::runtime_error if
+        // the file cannot be read.
+        void loadConstantsFile(const std::string& path);
+
+        // Every loaded constant, in table order
+        std::span<const ConstantRecord> constants() const {
+            return table.records;
+        }
+
+        // The loaded records with their indexes
+        const Table<ConstantRecord>& constantTable() const {
+            return table;
+        }
+
+        // Groups in table order
+        std::vector<std::string_view> groups() const;
+
+        // Number of the group of each constant, numbered in table order, as groups lists them
+        std::span<const std::uint32_t> groupIds() const {
+            return groupOf;
+        }
+
+        // The constant with the given symbol or case-agnostic name, or nullptr. Within a
+        // table the first constant wins a shared key; as for units, the later of a symbol
+        // and a name match wins, so tables loaded later override earlier ones by either.
+        const ConstantRecord* findConstant(std::string_view input) const noexcept;
+
+        // Value of the constant with the given symbol or name, read from a column parsed
+        // when the table was loaded. Never allocates or throws.
+        std::expected<double, libuc::Error> value(std::string_view input) const noexcept;
+
+        // Value of a constant by its position in constants, or NaN for a value that is not
+        // a number
+        double value(UnitId id) const noexcept {
+            return values[id];
+        }
+};
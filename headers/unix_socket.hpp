@@ -0,0 +1,454 @@
+// unix_socket.hpp: Line-oriented request/response server and client over a Unix socket
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <csignal>
+#include <cstddef>
+#include <cstring>
+#include <format>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#endif
+
+
+// Requests are single lines. Each is answered, in order, by a frame `OK <n>\n` or
+// `ERR <n>\n` followed by n bytes of payload, so clients may pipeline any number of
+// requests before reading the responses.
+namespace unix_socket {
+    inline sockaddr_un address(const std::string& path) {
+        sockaddr_un address = {};
+        address.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(address.sun_path))
+            throw std::runtime_error("Socket path too long: " + path);
+        std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+        return address;
+    }
+
+    inline void setNonBlocking(int fd) {
+        int flags = fcntl(fd, F_GETFL);
+        if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0)
+            throw std::runtime_error("Unable to configure socket");
+    }
+
+    // Parses one frame at the front of input, returning its size, or 0 if incomplete
+    inline std::size_t parseFrame(std::string_view input, bool& ok, std::string_view& payload) {
+        std::size_t newline = input.find('\n');
+        if (newline == std::string_view::npos)
+            return 0;
+        std::string_view header = input.substr(0, newline);
+        std::size_t space = header.find(' ');
+        std::size_t length = 0;
+        if (space == std::string_view::npos ||
+            std::from_chars(header.data() + space + 1, header.data() + header.size(), length).ec != std::errc())
+            throw std::runtime_error("Malformed response from server");
+        if (input.size() - newline - 1 < length)
+            return 0;
+        ok = header.substr(0, space) == "OK";
+        payload = input.substr(newline + 1, length);
+        return newline + 1 + length;
+    }
+}
+
+
+// Waits for readiness on a set of descriptors: epoll on Linux, poll elsewhere. Level
+// triggered, so a descriptor left with unread input is reported again.
+class Poller {
+    public:
+        struct Event {
+            int fd;
+            bool readable;
+            bool writable;
+        };
+
+    private:
+#ifdef __linux__
+        int epollFd;
+        std::vector<epoll_event> ready = std::vector<epoll_event>(256);
+
+        void control(int operation, int fd, bool read, bool write) {
+            epoll_event event = {};
+            event.events = (read ? EPOLLIN : 0u) | (write ? EPOLLOUT : 0u);
+            event.data.fd = fd;
+            if (epoll_ctl(epollFd, operation, fd, &event) != 0)
+                throw std::runtime_error("Unable to watch socket");
+        }
+#else
+        std::vector<pollfd> watched;
+
+        std::vector<pollfd>::iterator find(int fd) {
+            return std::find_if(watched.begin(), watched.end(), [fd](const pollfd& entry) { return entry.fd == fd; });
+        }
+#endif
+
+    public:
+#ifdef __linux__
+        Poller() : epollFd(epoll_create1(EPOLL_CLOEXEC)) {
+            if (epollFd < 0)
+                throw std::runtime_error("Unable to create event loop");
+        }
+
+        ~Poller() {
+            close(epollFd);
+        }
+
+        void add(int fd, bool read, bool write) {
+            control(EPOLL_CTL_ADD, fd, read, write);
+        }
+
+        void modify(int fd, bool read, bool write) {
+            control(EPOLL_CTL_MOD, fd, read, write);
+        }
+
+        void remove(int fd) {
+            epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+        }
+
+        // Waits for at least one event, returning false if interrupted by a signal
+        bool wait(std::vector<Event>& events) {
+            events.clear();
+            int count = epoll_wait(epollFd, ready.data(), static_cast<int>(ready.size()), -1);
+            if (count < 0 && errno == EINTR)
+                return false;
+            if (count < 0)
+                throw std::runtime_error("Event loop failed");
+            for (int i = 0; i < count; ++i) {
+                const epoll_event& event = ready[static_cast<std::size_t>(i)];
+                events.push_back({ event.data.fd, (event.events & (EPOLLIN | EPOLLHUP | EPOLLERR)) != 0,
+                                   (event.events & EPOLLOUT) != 0 });
+            }
+            return true;
+        }
+#else
+        Poller() = default;
+
+        void add(int fd, bool read, bool write) {
+            watched.push_back({ fd, 0, 0 });
+            modify(fd, read, write);
+        }
+
+        void modify(int fd, bool read, bool write) {
+            find(fd)->events = static_cast<short>((read ? POLLIN : 0) | (write ? POLLOUT : 0));
+        }
+
+        void remove(int fd) {
+            watched.erase(find(fd));
+        }
+
+        bool wait(std::vector<Event>& events) {
+            events.clear();
+            int count = poll(watched.data(), static_cast<nfds_t>(watched.size()), -1);
+            if (count < 0 && errno == EINTR)
+                return false;
+            if (count < 0)
+                throw std::runtime_error("Event loop failed");
+            for (const pollfd& entry: watched) {
+                if (entry.revents != 0)
+                    events.push_back({ entry.fd, (entry.revents & (POLLIN | POLLHUP | POLLERR)) != 0,
+                                       (entry.revents & POLLOUT) != 0 });
+            }
+            return true;
+        }
+#endif
+
+        Poller(const Poller&) = delete;
+        Poller& operator=(const Poller&) = delete;
+};
+
+
+// Serves line requests on a Unix socket from a single-threaded event loop. Each request
+// is passed to the handler, which appends its answer to the response and returns false
+// if the request failed.
+class UnixServer {
+    public:
+        using Handler = std::function<bool(std::string_view request, std::string& response)>;
+
+    private:
+        // Stop reading a client's requests while this much of its output is unsent
+        static constexpr std::size_t maxPending = 1 << 20;
+        static constexpr std::size_t maxRequest = 1 << 16;
+
+        struct Connection {
+            std::string input;
+            std::string output;
+            std::size_t written = 0;
+            bool reading = true;
+            bool closing = false;
+        };
+
+        std::string path;
+        int listener = -1;
+        int wake[2] = { -1, -1 };
+
+        // Answers the complete requests in input, leaving any partial line
+        static void answer(Connection& connection, const Handler& handler) {
+            std::string_view input = connection.input;
+            std::string response;
+            std::size_t newline;
+            while ((newline = input.find('\n')) != std::string_view::npos) {
+                std::string_view request = input.substr(0, newline);
+                if (!request.empty() && request.back() == '\r')
+                    request.remove_suffix(1);
+                input.remove_prefix(newline + 1);
+
+                response.clear();
+                bool ok;
+                try {
+                    ok = handler(request, response);
+                } catch (const std::exception& e) {
+                    response = e.what();
+                    ok = false;
+                }
+                std::format_to(std::back_inserter(connection.output), "{} {}\n", ok ? "OK" : "ERR", response.size());
+                connection.output += response;
+            }
+            connection.input.erase(0, connection.input.size() - input.size());
+            if (connection.input.size() > maxRequest) {
+                std::string error = "Request too long";
+                std::format_to(std::back_inserter(connection.output), "ERR {}\n{}", error.size(), error);
+                connection.input.clear();
+                connection.closing = true;
+            }
+        }
+
+        // Writes as much pending output as the socket takes. Returns false on a dead client.
+        static bool flush(int fd, Connection& connection) {
+            while (connection.written < connection.output.size()) {
+                ssize_t sent = send(fd, connection.output.data() + connection.written,
+                                    connection.output.size() - connection.written, 0);
+                if (sent < 0 && errno == EINTR)
+                    continue;
+                if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+                    break;
+                if (sent < 0)
+                    return false;
+                connection.written += static_cast<std::size_t>(sent);
+            }
+            if (connection.written == connection.output.size()) {
+                connection.output.clear();
+                connection.written = 0;
+            }
+            return true;
+        }
+
+    public:
+        // Listens on path, replacing a stale socket left by a server that did not exit
+        // cleanly. Throws std::runtime_error if the socket cannot be created, or if a
+        // server is still listening on path.
+        explicit UnixServer(std::string socketPath) : path(std::move(socketPath)) {
+            sockaddr_un address = unix_socket::address(path);
+            listener = socket(AF_UNIX, SOCK_STREAM, 0);
+            if (listener < 0 || pipe(wake) != 0) {
+                if (listener >= 0)
+                    close(listener);
+                throw std::runtime_error("Unable to create socket");
+            }
+            struct stat existing;
+            if (stat(path.c_str(), &existing) == 0 && S_ISSOCK(existing.st_mode)) {
+                // Only a socket that refuses connections is stale
+                int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+                bool stale = probe >= 0 && connect(probe, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 &&
+                             (errno == ECONNREFUSED || errno == ENOENT);
+                if (probe >= 0)
+                    close(probe);
+                if (!stale) {
+                    close(listener);
+                    close(wake[0]);
+                    close(wake[1]);
+                    throw std::runtime_error(probe < 0 ? "Unable to create socket" : "Daemon already running on " + path);
+                }
+                unlink(path.c_str());
+            }
+            if (bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+                listen(listener, SOMAXCONN) != 0) {
+                close(listener);
+                close(wake[0]);
+                close(wake[1]);
+                throw std::runtime_error("Unable to listen on " + path);
+            }
+            unix_socket::setNonBlocking(listener);
+            unix_socket::setNonBlocking(wake[0]);
+        }
+
+        ~UnixServer() {
+            close(listener);
+            close(wake[0]);
+            close(wake[1]);
+            unlink(path.c_str());
+        }
+
+        UnixServer(const UnixServer&) = delete;
+        UnixServer& operator=(const UnixServer&) = delete;
+
+        // Makes run return. Safe to call from another thread or a signal handler.
+        void stop() {
+            char byte = 0;
+            [[maybe_unused]] ssize_t ignored = write(wake[1], &byte, 1);
+        }
+
+        // Serves clients until stop is called
+        void run(const Handler& handler) {
+            // A client that disconnects early must not kill the server
+            std::signal(SIGPIPE, SIG_IGN);
+
+            Poller poller;
+            poller.add(listener, true, false);
+            poller.add(wake[0], true, false);
+            std::unordered_map<int, Connection> connections;
+            std::vector<Poller::Event> events;
+            char buffer[1 << 16];
+
+            auto disconnect = [&](int fd) {
+                poller.remove(fd);
+                close(fd);
+                connections.erase(fd);
+            };
+
+            bool running = true;
+            while (running) {
+                if (!poller.wait(events))
+                    continue;
+                for (const Poller::Event& event: events) {
+                    if (event.fd == wake[0]) {
+                        running = false;
+                        continue;
+                    }
+                    if (event.fd == listener) {
+                        int client;
+                        while ((client = accept(listener, nullptr, nullptr)) >= 0) {
+                            unix_socket::setNonBlocking(client);
+                            connections.emplace(client, Connection());
+                            poller.add(client, true, false);
+                        }
+                        continue;
+                    }
+
+                    auto found = connections.find(event.fd);
+                    if (found == connections.end())
+                        continue;
+                    Connection& connection = found->second;
+
+                    if (event.readable && connection.reading) {
+                        ssize_t got = recv(event.fd, buffer, sizeof(buffer), 0);
+                        if (got > 0) {
+                            connection.input.append(buffer, static_cast<std::size_t>(got));
+                            answer(connection, handler);
+                        } else if (got == 0 || (errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK)) {
+                            connection.closing = true;
+                        }
+                    }
+
+                    if (!flush(event.fd, connection) || (connection.closing && connection.output.empty())) {
+                        disconnect(event.fd);
+                        continue;
+                    }
+                    bool reading = !connection.closing && connection.output.size() - connection.written < maxPending;
+                    bool writing = !connection.output.empty();
+                    if (reading != connection.reading || writing || event.writable) {
+                        connection.reading = reading;
+                        poller.modify(event.fd, reading, writing);
+                    }
+                }
+            }
+
+            for (auto& [fd, connection]: connections)
+                close(fd);
+        }
+};
+
+
+// Connection to a UnixServer
+class UnixClient {
+    private:
+        int fd;
+
+    public:
+        // Throws std::runtime_error if no server is listening on path
+        explicit UnixClient(const std::string& path) : fd(socket(AF_UNIX, SOCK_STREAM, 0)) {
+            sockaddr_un address = unix_socket::address(path);
+            if (fd < 0 || connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+                if (fd >= 0)
+                    close(fd);
+                throw std::runtime_error("Unable to connect to " + path);
+            }
+        }
+
+        ~UnixClient() {
+            close(fd);
+        }
+
+        UnixClient(const UnixClient&) = delete;
+        UnixClient& operator=(const UnixClient&) = delete;
+
+        // Sends newline-terminated requests without waiting between them and calls
+        // onResponse(ok, payload) for each answer, in order. Sending and receiving are
+        // interleaved, so any number of requests may be in flight.
+        template <typename OnResponse>
+        void exchange(std::string_view requests, OnResponse onResponse) {
+            std::size_t expected = static_cast<std::size_t>(std::count(requests.begin(), requests.end(), '\n'));
+            std::string input;
+            char buffer[1 << 16];
+
+            while (expected > 0) {
+                pollfd entry = { fd, static_cast<short>(POLLIN | (requests.empty() ? 0 : POLLOUT)), 0 };
+                if (poll(&entry, 1, -1) < 0) {
+                    if (errno == EINTR)
+                        continue;
+                    throw std::runtime_error("Unable to reach server");
+                }
+
+                if ((entry.revents & POLLOUT) != 0) {
+                    ssize_t sent = send(fd, requests.data(), requests.size(), MSG_DONTWAIT);
+                    if (sent < 0 && errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK)
+                        throw std::runtime_error("Unable to reach server");
+                    if (sent > 0)
+                        requests.remove_prefix(static_cast<std::size_t>(sent));
+                }
+
+                if ((entry.revents & (POLLIN | POLLHUP | POLLERR)) != 0) {
+                    ssize_t got = recv(fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+                    if (got == 0 || (got < 0 && errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK))
+                        throw std::runtime_error("Server closed the connection");
+                    if (got > 0)
+                        input.append(buffer, static_cast<std::size_t>(got));
+
+                    std::size_t consumed = 0, size;
+                    bool ok;
+                    std::string_view payload;
+                    while (expected > 0 && (size = unix_socket::parseFrame(std::string_view(input).substr(consumed), ok, payload)) > 0) {
+                        onResponse(ok, payload);
+                        consumed += size;
+                        --expected;
+                    }
+                    input.erase(0, consumed);
+                }
+            }
+        }
+
+        // Sends one request and returns whether it succeeded, with its answer in response
+        bool request(std::string_view line, std::string& response) {
+            std::string framed(line);
+            framed.push_back('\n');
+            bool result = false;
+            exchange(framed, [&](bool ok, std::string_view payload) {
+                result = ok;
+                response.assign(payload);
+            });
+            return result;
+        }
+};
@@ -0,0 +1,434 @@
+// batch.cpp: Batch conversion of text lines and binary columns
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <cstring>
+#include <exception>
+#include <format>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <system_error>
+
+#include "batch.hpp"
+#include "file_io.hpp"
+#include "mapped_file.hpp"
+#include "thread_pool.hpp"
+
+
+bool parseNumber(std::string_view token, double& value) {
+    UC_STATS_SCOPE(Stage::Parse);
+    const char* end = token.data() + token.size();
+    auto [ptr, ec] = std::from_chars(token.data(), end, value);
+    return ec == std::errc() && ptr == end;
+}
+
+
+void splitFields(std::string_view line, std::vector<std::string_view>& fields) {
+    fields.clear();
+    while (!line.empty()) {
+        std::size_t start = line.find_first_not_of(" \t\r");
+        if (start == std::string_view::npos)
+            break;
+        line.remove_prefix(start);
+        std::size_t stop = std::min(line.find_first_of(" \t\r"), line.size());
+        fields.push_back(line.substr(0, stop));
+        line.remove_prefix(stop);
+    }
+}
+
+
+BatchPair resolvePair(const Units& u, std::string_view unitFrom, std::string_view unitTo) {
+    u.convertValue(0, unitFrom, unitTo);
+    return { unitFrom, unitTo, u.findUnit(unitFrom), u.findUnit(unitTo), *u.plan(unitFrom, unitTo) };
+}
+
+
+double convertFields(std::span<const std::string_view> fields, const Units& u, const BatchPair* pair,
+                     std::string* history) {
+    double amount;
+    if (!parseNumber(fields.front(), amount))
+        throw std::invalid_argument(std::string(fields.front()) + " is not a valid number.");
+
+    double result;
+    std::string_view unitFrom, unitTo;
+    if (pair != nullptr && fields.size() == 1) {
+        result = amount * pair->conversion.scale + pair->conversion.offset;
+        unitFrom = pair->unitFrom;
+        unitTo = pair->unitTo;
+    } else if (pair != nullptr || fields.size() < 3) {
+        throw std::invalid_argument(std::string("Expected ") + (pair != nullptr ? "<value>" : "<value> <from_unit> <to_unit>"));
+    } else if (fields.size() == 3) {
+        result = u.convertValue(amount, fields[1], fields[2]);
+        unitFrom = fields[1];
+        unitTo = fields[2];
+    } else {
+        // Symbols such as "fl oz" contain spaces: rejoin the remaining fields and retry
+        // each split point until both units resolve
+        std::string_view units(fields[1].data(), fields.back().data() + fields.back().size() - fields[1].data());
+        for (std::size_t i = 2; i < fields.size() && unitFrom.empty(); ++i) {
+            std::string_view from = units.substr(0, fields[i - 1].data() + fields[i - 1].size() - units.data());
+            std::string_view to = units.substr(fields[i].data() - units.data());
+            if ((u.findUnit(from) != unknownUnit && u.findUnit(to) != unknownUnit) || u.plan(from, to)) {
+                unitFrom = from;
+                unitTo = to;
+            }
+        }
+        if (unitFrom.empty())
+            throw std::invalid_argument("Unknown units: " + std::string(units));
+        result = u.convertValue(amount, unitFrom, unitTo);
+    }
+
+    if (history != nullptr)
+        History::record(*history, amount, unitFrom, unitTo, result);
+    return result;
+}
+
+
+std::size_t convertLines(std::istream& in, std::ostream& out, std::ostream& errors, const Units& u,
+                         const std::string& unitFrom, const std::string& unitTo, std::size_t firstLine,
+                         std::string* history, const NumberFormat& format) {
+    const bool fixedPair = !unitFrom.empty();
+    OutputBuffer output(out, format);
+
+    // A fixed pair is applied to blocks of values with convertSpan
+    BatchPair pair;
+    if (fixedPair)
+        pair = resolvePair(u, unitFrom, unitTo);
+    std::vector<double> values;
+    std::vector<double> results;
+    auto flushValues = [&]() {
+        results.resize(values.size());
+        u.convertSpan(values, results, pair.conversion);
+        for (double result: results)
+            output << result << '\n';
+        for (std::size_t i = 0; history != nullptr && i < values.size(); ++i)
+            History::record(*history, values[i], unitFrom, unitTo, results[i]);
+        values.clear();
+    };
+
+    std::size_t lineNumber = firstLine - 1;
+    std::size_t failures = 0;
+    std::string line;
+    std::vector<std::string_view> fields;
+
+    while (std::getline(in, line)) {
+        ++lineNumber;
+        splitFields(line, fields);
+        if (fields.empty())
+            continue;
+
+        double amount;
+        if (fixedPair && fields.size() == 1 && parseNumber(fields.front(), amount)) {
+            values.push_back(amount);
+            if (values.size() == 4096)
+                flushValues();
+            continue;
+        }
+
+        try {
+            output << convertFields(fields, u, fixedPair ? &pair : nullptr, history) << '\n';
+        } catch (const std::invalid_argument& e) {
+            errors << "Line " << lineNumber << ": " << e.what() << '\n';
+            ++failures;
+        }
+    }
+    if (fixedPair)
+        flushValues();
+    output.flush();
+    out.flush();
+    return failures;
+}
+
+
+std::size_t convertText(std::string_view text, std::string& out, std::string& errors, const Units& u,
+                        const BatchPair* pair, std::size_t firstLine, std::string* history,
+                        const NumberFormat& format) {
+    std::size_t lineNumber = firstLine - 1;
+    std::size_t failures = 0;
+    std::vector<std::string_view> fields;
+
+    while (!text.empty()) {
+        std::size_t end = std::min(text.find('\n'), text.size());
+        std::string_view line = text.substr(0, end);
+        text.remove_prefix(std::min(end + 1, text.size()));
+        ++lineNumber;
+
+        splitFields(line, fields);
+        if (fields.empty())
+            continue;
+
+        try {
+            appendNumber(out, convertFields(fields, u, pair, history), format);
+            out.push_back('\n');
+        } catch (const std::invalid_argument& e) {
+            errors += std::format("Line {}: {}\n", lineNumber, e.what());
+            ++failures;
+        }
+    }
+    return failures;
+}
+
+
+std::size_t convertBatch(std::istream& in, std::ostream& out, const Units& u, const std::string& unitFrom,
+                         const std::string& unitTo, unsigned jobs, History* history, const NumberFormat& format) {
+    if (jobs == 1 && history == nullptr)
+        return convertLines(in, out, std::cerr, u, unitFrom, unitTo, 1, nullptr, format);
+
+    if (!unitFrom.empty())
+        resolvePair(u, unitFrom, unitTo);
+
+    struct Block {
+        std::string input;
+        std::size_t firstLine = 1;
+        std::string output;
+        std::string errors;
+        std::string records;
+        std::size_t failures = 0;
+        // What the block's task threw, rethrown on the calling thread
+        std::exception_ptr error;
+    };
+
+    // Reads up to window blocks of about blockSize bytes, each ending on a line boundary.
+    // A line longer than a block is read on until it ends.
+    const std::size_t blockSize = 1 << 20;
+    std::string carry;
+    std::size_t nextLine = 1;
+    auto readWindow = [&](std::size_t window) {
+        std::vector<Block> blocks;
+        while (blocks.size() < window && (in || !carry.empty())) {
+            Block block;
+            block.input = std::move(carry);
+            carry.clear();
+            std::size_t lastNewline = std::string::npos;
+            while (in && lastNewline == std::string::npos) {
+                std::size_t kept = block.input.size();
+                block.input.resize(kept + blockSize);
+                in.read(block.input.data() + kept, static_cast<std::streamsize>(blockSize));
+                block.input.resize(kept + static_cast<std::size_t>(in.gcount()));
+                // The carried text holds no newline, so only what was read needs searching
+                lastNewline = std::string_view(block.input).substr(kept).rfind('\n');
+                if (lastNewline != std::string::npos)
+                    lastNewline += kept;
+            }
+            if (in) {
+                carry.assign(block.input, lastNewline + 1);
+                block.input.resize(lastNewline + 1);
+            }
+            if (block.input.empty())
+                break;
+            block.firstLine = nextLine;
+            nextLine += static_cast<std::size_t>(std::count(block.input.begin(), block.input.end(), '\n'));
+            blocks.push_back(std::move(block));
+        }
+        return blocks;
+    };
+
+    std::unique_ptr<WorkStealingPool> pool;
+    if (jobs != 1)
+        pool = std::make_unique<WorkStealingPool>(jobs);
+    const std::size_t window = pool ? 4 * pool->size() : 1;
+
+    std::size_t failures = 0;
+    std::vector<Block> current = readWindow(window);
+    while (!current.empty()) {
+        for (Block& block: current) {
+            auto task = [&block, &u, &unitFrom, &unitTo, history, &format]() {
+                try {
+                    std::istringstream input(std::move(block.input));
+                    std::ostringstream output, errors;
+                    block.failures = convertLines(input, output, errors, u, unitFrom, unitTo, block.firstLine,
+                                                  history != nullptr ? &block.records : nullptr, format);
+                    block.output = std::move(output).str();
+                    block.errors = std::move(errors).str();
+                } catch (const std::exception&) {
+                    block.error = std::current_exception();
+                }
+            };
+            if (pool)
+                pool->submit(task);
+            else
+                task();
+        }
+
+        // Read ahead while the pool converts
+        std::vector<Block> next = readWindow(window);
+        if (pool)
+            pool->wait();
+        for (const Block& block: current) {
+            if (block.error)
+                std::rethrow_exception(block.error);
+            out.write(block.output.data(), static_cast<std::streamsize>(block.output.size()));
+            std::cerr << block.errors;
+            failures += block.failures;
+            if (history != nullptr)
+                history->append(block.records);
+        }
+        current = std::move(next);
+    }
+    out.flush();
+    return failures;
+}
+
+
+std::size_t convertMappedFile(const std::string& path, int fd, const Units& u, const std::string& unitFrom,
+                              const std::string& unitTo, unsigned jobs, History* history, const NumberFormat& format) {
+    BatchPair pair;
+    if (!unitFrom.empty())
+        pair = resolvePair(u, unitFrom, unitTo);
+    const BatchPair* fixed = unitFrom.empty() ? nullptr : &pair;
+
+    MappedFile file(path);
+    std::string_view text = file.view();
+
+    struct Block {
+        std::size_t offset = 0;
+        std::string_view input;
+        std::size_t firstLine = 1;
+        std::string output;
+        std::string errors;
+        std::string records;
+        std::size_t failures = 0;
+        // What the block's task threw, rethrown on the calling thread
+        std::exception_ptr error;
+    };
+
+    // Cuts up to count blocks of about blockSize bytes, each ending on a line boundary
+    const std::size_t blockSize = 8 << 20;
+    std::size_t offset = 0;
+    std::size_t nextLine = 1;
+    auto nextBlocks = [&](std::size_t count) {
+        std::vector<Block> blocks;
+        while (blocks.size() < count && offset < text.size()) {
+            std::size_t end = std::min(offset + blockSize, text.size());
+            std::size_t newline = text.find('\n', end - 1);
+            end = newline == std::string_view::npos ? text.size() : newline + 1;
+
+            Block block;
+            block.offset = offset;
+            block.input = text.substr(offset, end - offset);
+            block.firstLine = nextLine;
+            block.output.reserve(block.input.size() + block.input.size() / 2);
+            nextLine += static_cast<std::size_t>(std::count(block.input.begin(), block.input.end(), '\n'));
+            offset = end;
+            blocks.push_back(std::move(block));
+        }
+        return blocks;
+    };
+
+    std::unique_ptr<WorkStealingPool> pool;
+    if (jobs != 1)
+        pool = std::make_unique<WorkStealingPool>(jobs);
+    const std::size_t window = pool ? 2 * pool->size() : 1;
+
+    std::cout.flush();
+    std::size_t failures = 0;
+    for (std::vector<Block> blocks = nextBlocks(window); !blocks.empty(); blocks = nextBlocks(window)) {
+        for (Block& block: blocks) {
+            auto task = [&block, &u, fixed, history, &format]() {
+                try {
+                    block.failures = convertText(block.input, block.output, block.errors, u, fixed, block.firstLine,
+                                                 history != nullptr ? &block.records : nullptr, format);
+                } catch (const std::exception&) {
+                    block.error = std::current_exception();
+                }
+            };
+            if (pool)
+                pool->submit(task);
+            else
+                task();
+        }
+        if (pool)
+            pool->wait();
+
+        for (const Block& block: blocks) {
+            if (block.error)
+                std::rethrow_exception(block.error);
+            writeAll(fd, block.output);
+            std::cerr << block.errors;
+            failures += block.failures;
+            if (history != nullptr)
+                history->append(block.records);
+            file.release(block.offset, block.input.size());
+        }
+    }
+    return failures;
+}
+
+
+void toLittleEndian(char* data, std::size_t size, std::size_t width) {
+    if constexpr (std::endian::native == std::endian::big) {
+        for (std::size_t i = 0; i + width <= size; i += width)
+            std::reverse(data + i, data + i + width);
+    }
+}
+
+
+std::size_t convertBinary(int inFd, int outFd, const Units& u, std::string unitFrom, std::string unitTo,
+                          std::size_t width, bool header) {
+    if (header) {
+        BinaryHeader in;
+        if (readFull(inFd, reinterpret_cast<char*>(&in), sizeof(in)) != sizeof(in) || std::memcmp(in.magic, "UCB1", 4) != 0)
+            throw std::invalid_argument("Invalid binary header");
+        width = in.width;
+        unitFrom.assign(in.from, strnlen(in.from, sizeof(in.from)));
+        if (unitTo.empty())
+            unitTo.assign(in.to, strnlen(in.to, sizeof(in.to)));
+    }
+    if (width != 4 && width != 8)
+        throw std::invalid_argument("Invalid value width: " + std::to_string(width));
+
+    BatchPair pair = resolvePair(u, unitFrom, unitTo);
+
+    if (header) {
+        BinaryHeader out;
+        out.width = static_cast<std::uint8_t>(width);
+        std::memcpy(out.from, unitTo.data(), std::min(unitTo.size(), sizeof(out.from)));
+        writeAll(outFd, std::string_view(reinterpret_cast<const char*>(&out), sizeof(out)));
+    }
+
+    const std::size_t blockValues = 1 << 16;
+    std::vector<char> bytes(blockValues * width);
+    std::vector<double> values(blockValues);
+    std::vector<double> results(blockValues);
+    std::size_t converted = 0;
+
+    while (true) {
+        std::size_t got = readFull(inFd, bytes.data(), bytes.size());
+        if (got % width != 0)
+            throw std::invalid_argument("Truncated input: " + std::to_string(got % width) + " trailing bytes");
+        std::size_t count = got / width;
+        if (count == 0)
+            break;
+
+        toLittleEndian(bytes.data(), got, width);
+        if (width == 8) {
+            std::memcpy(values.data(), bytes.data(), got);
+        } else {
+            for (std::size_t i = 0; i < count; ++i) {
+                float value;
+                std::memcpy(&value, bytes.data() + i * 4, 4);
+                values[i] = value;
+            }
+        }
+
+        u.convertSpan(std::span<const double>(values.data(), count), std::span<double>(results.data(), count), pair.conversion);
+
+        if (width == 8) {
+            std::memcpy(bytes.data(), results.data(), got);
+        } else {
+            for (std::size_t i = 0; i < count; ++i) {
+                float value = static_cast<float>(results[i]);
+                std::memcpy(bytes.data() + i * 4, &value, 4);
+            }
+        }
+        toLittleEndian(bytes.data(), got, width);
+        writeAll(outFd, std::string_view(bytes.data(), got));
+        converted += count;
+
+        if (got < bytes.size())
+            break;
+    }
+    return converted;
+}
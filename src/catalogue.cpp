@@ -0,0 +1,393 @@
+// catalogue.cpp: Unit and constant files, and their snapshots
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <system_error>
+
+#include <unistd.h>
+
+#include "catalogue.hpp"
+#include "mapped_file.hpp"
+
+
+namespace {
+    // A snapshot holds every loaded table with its indexes and factor matrix, laid out as
+    // this header and then these sections, each padded to 8 bytes:
+    //   stamps       the files loaded, with their sizes and modification times
+    //   text         the fields of every record
+    //   StoredUnit[units], symbol and name index ids[unitSlots],
+    //   categoryOf and position[units], categorySize and matrixStart[categories],
+    //   Conversion[matrixEntries],
+    //   StoredConstant[constants], symbol and name index ids[constantSlots]
+    // Index slots keep only their ids, as their keys are fields of the records.
+    struct SnapshotHeader {
+        char magic[8] = { 'U', 'C', 'S', 'N', 'A', 'P', '2', '\0' };
+        std::uint64_t builtinHash = 0;
+        std::uint64_t stampBytes = 0;
+        std::uint64_t textBytes = 0;
+        std::uint64_t units = 0;
+        std::uint64_t unitSlots = 0;
+        std::uint64_t categories = 0;
+        std::uint64_t matrixEntries = 0;
+        std::uint64_t constants = 0;
+        std::uint64_t constantSlots = 0;
+    };
+
+    struct StoredField {
+        std::uint32_t offset;
+        std::uint32_t length;
+    };
+
+    struct StoredUnit {
+        StoredField category, name, symbol, baseUnit;
+        double conversionFactor;
+        Rational exactFactor;
+    };
+
+    struct StoredConstant {
+        StoredField group, name, symbol, value, unit;
+    };
+
+
+    // Snapshots of other builds, whose built-in tables may differ, are not reused
+    std::uint64_t builtinHash() {
+        return hashKey(listOfUnits, false) * 31 + hashKey(listOfConstants, false) + sizeof(SnapshotHeader);
+    }
+
+    // One line per file loaded, in order, with its size and modification time
+    std::string stamps(const CatalogueFiles& files) {
+        std::string text;
+        auto stamp = [&](const char* kind, const std::string& path) {
+            std::error_code error;
+            auto size = std::filesystem::file_size(path, error);
+            auto modified = std::filesystem::last_write_time(path, error);
+            if (error)
+                throw std::runtime_error("Unable to open file: " + path);
+            text += std::format("{}\t{}\t{}\t{}\n", kind, path, size, modified.time_since_epoch().count());
+        };
+        for (const std::string& path: files.units)
+            stamp("units", path);
+        for (const std::string& path: files.constants)
+            stamp("constants", path);
+        return text;
+    }
+
+    // Snapshots are named by the files they hold, so each set of files has its own
+    std::filesystem::path snapshotPath(const std::filesystem::path& cacheDirectory, const CatalogueFiles& files) {
+        std::string paths;
+        for (const std::string& path: files.units)
+            paths += "u" + path + '\n';
+        for (const std::string& path: files.constants)
+            paths += "c" + path + '\n';
+        return cacheDirectory / std::format("catalogue-{:016x}.snap", hashKey(paths, false));
+    }
+
+
+    class SnapshotWriter {
+        private:
+            std::string bytes;
+            std::string text;
+
+        public:
+            StoredField field(std::string_view value) {
+                if (text.size() + value.size() > UINT32_MAX)
+                    throw std::runtime_error("Catalogue too large for a snapshot");
+                StoredField stored = { static_cast<std::uint32_t>(text.size()), static_cast<std::uint32_t>(value.size()) };
+                text += value;
+                return stored;
+            }
+
+            const std::string& fields() const {
+                return text;
+            }
+
+            void append(const void* data, std::size_t size) {
+                bytes.append(static_cast<const char*>(data), size);
+                bytes.resize((bytes.size() + 7) / 8 * 8, '\0');
+            }
+
+            template <class T>
+            void append(std::span<const T> values) {
+                append(values.data(), values.size_bytes());
+            }
+
+            // Ids of an index's slots
+            void append(std::span<const IndexSlot> slots) {
+                std::vector<UnitId> ids;
+                ids.reserve(slots.size());
+                for (const IndexSlot& slot: slots)
+                    ids.push_back(slot.id);
+                append(std::span<const UnitId>(ids));
+            }
+
+            // Writes the snapshot beside path and renames it into place, so readers never
+            // see part of one
+            void save(const std::filesystem::path& path) const {
+                std::filesystem::create_directories(path.parent_path());
+                const std::filesystem::path written(path.native() + std::format(".{}", getpid()));
+                {
+                    std::ofstream out(written, std::ios::binary | std::ios::trunc);
+                    out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+                    if (!out)
+                        throw std::runtime_error("Unable to write snapshot");
+                }
+                std::filesystem::rename(written, path);
+            }
+    };
+
+
+    void saveSnapshot(const std::filesystem::path& path, const std::string& stamped, const Units& u, const Constants& c) {
+        const Table<UnitRecord>& units = u.unitTable();
+        const FactorMatrix& factors = u.unitFactors();
+        const Table<ConstantRecord>& constants = c.constantTable();
+
+        SnapshotWriter writer;
+        std::vector<StoredUnit> storedUnits;
+        for (const UnitRecord& unit: units.records) {
+            storedUnits.push_back({ writer.field(unit.category), writer.field(unit.name), writer.field(unit.symbol),
+                                    writer.field(unit.baseUnit), unit.conversionFactor, unit.exactFactor });
+        }
+        std::vector<StoredConstant> storedConstants;
+        for (const ConstantRecord& constant: constants.records) {
+            storedConstants.push_back({ writer.field(constant.group), writer.field(constant.name), writer.field(constant.symbol),
+                                        writer.field(constant.value), writer.field(constant.unit) });
+        }
+
+        SnapshotHeader header;
+        header.builtinHash = builtinHash();
+        header.stampBytes = stamped.size();
+        header.textBytes = writer.fields().size();
+        header.units = units.records.size();
+        header.unitSlots = units.symbolIndex.size();
+        header.categories = factors.categorySize.size();
+        header.matrixEntries = factors.matrix.size();
+        header.constants = constants.records.size();
+        header.constantSlots = constants.symbolIndex.size();
+
+        writer.append(&header, sizeof(header));
+        writer.append(stamped.data(), stamped.size());
+        writer.append(writer.fields().data(), writer.fields().size());
+        writer.append(std::span<const StoredUnit>(storedUnits));
+        writer.append(units.symbolIndex);
+        writer.append(units.nameIndex);
+        writer.append(factors.categoryOf);
+        writer.append(factors.position);
+        writer.append(factors.categorySize);
+        writer.append(factors.matrixStart);
+        writer.append(factors.matrix);
+        writer.append(std::span<const StoredConstant>(storedConstants));
+        writer.append(constants.symbolIndex);
+        writer.append(constants.nameIndex);
+        writer.save(path);
+    }
+
+
+    // A mapped snapshot and the records rebuilt from it. The factor matrix is used in
+    // place; records and index slots hold views, so they are rebuilt, which is linear
+    // and involves no parsing or hashing.
+    struct Snapshot {
+        MappedFile file;
+        std::vector<UnitRecord> units;
+        std::vector<IndexSlot> unitSymbols, unitNames;
+        std::vector<ConstantRecord> constants;
+        std::vector<IndexSlot> constantSymbols, constantNames;
+        FactorMatrix factors;
+
+        explicit Snapshot(const std::string& path) : file(path) {}
+    };
+
+
+    // Reads the sections of a snapshot in order, checking that each lies in the file
+    class SnapshotReader {
+        private:
+            std::string_view bytes;
+            std::size_t offset = 0;
+
+        public:
+            explicit SnapshotReader(std::string_view bytes) : bytes(bytes) {}
+
+            template <class T>
+            std::span<const T> take(std::uint64_t count) {
+                if (count > (bytes.size() - offset) / sizeof(T))
+                    throw std::runtime_error("Truncated snapshot");
+                std::span<const T> values(reinterpret_cast<const T*>(bytes.data() + offset), static_cast<std::size_t>(count));
+                offset += (values.size_bytes() + 7) / 8 * 8;
+                offset = std::min(offset, bytes.size());
+                return values;
+            }
+
+            bool finished() const {
+                return offset == bytes.size();
+            }
+    };
+
+
+    // The snapshot at path, or nullptr if there is none or it does not hold the tables
+    // stamped
+    std::shared_ptr<const Snapshot> readSnapshot(const std::filesystem::path& path, const std::string& stamped) {
+        UC_STATS_SCOPE(Stage::Load);
+        std::shared_ptr<Snapshot> snapshot;
+        try {
+            snapshot = std::make_shared<Snapshot>(path.string());
+        } catch (const std::runtime_error&) {
+            return nullptr;
+        }
+
+        SnapshotReader reader(snapshot->file.view());
+        try {
+            const SnapshotHeader& header = reader.take<SnapshotHeader>(1)[0];
+            if (std::memcmp(header.magic, SnapshotHeader().magic, sizeof(header.magic)) != 0 || header.builtinHash != builtinHash())
+                return nullptr;
+            std::span<const char> stampText = reader.take<char>(header.stampBytes);
+            if (std::string_view(stampText.data(), stampText.size()) != stamped)
+                return nullptr;
+            std::span<const char> textBytes = reader.take<char>(header.textBytes);
+            std::string_view text(textBytes.data(), textBytes.size());
+            auto units = reader.take<StoredUnit>(header.units);
+            auto unitSymbols = reader.take<UnitId>(header.unitSlots);
+            auto unitNames = reader.take<UnitId>(header.unitSlots);
+            snapshot->factors.categoryOf = reader.take<std::uint32_t>(header.units);
+            snapshot->factors.position = reader.take<std::uint32_t>(header.units);
+            snapshot->factors.categorySize = reader.take<std::uint32_t>(header.categories);
+            snapshot->factors.matrixStart = reader.take<std::uint32_t>(header.categories);
+            snapshot->factors.matrix = reader.take<Conversion>(header.matrixEntries);
+            auto constants = reader.take<StoredConstant>(header.constants);
+            auto constantSymbols = reader.take<UnitId>(header.constantSlots);
+            auto constantNames = reader.take<UnitId>(header.constantSlots);
+            if (!reader.finished())
+                return nullptr;
+
+            // Checked, so that a damaged snapshot is rejected rather than read out of bounds
+            auto view = [&](StoredField field) {
+                if (field.offset > text.size() || field.length > text.size() - field.offset)
+                    throw std::runtime_error("Damaged snapshot");
+                return text.substr(field.offset, field.length);
+            };
+            auto index = [](std::span<const UnitId> ids, std::vector<IndexSlot>& slots, auto&& key, std::size_t records) {
+                if (!ids.empty() && (ids.size() & (ids.size() - 1)) != 0)
+                    throw std::runtime_error("Damaged snapshot");
+                slots.reserve(ids.size());
+                for (UnitId id: ids) {
+                    if (id != unknownUnit && id >= records)
+                        throw std::runtime_error("Damaged snapshot");
+                    slots.push_back({ id == unknownUnit ? std::string_view() : key(id), id });
+                }
+            };
+
+            snapshot->units.reserve(units.size());
+            for (const StoredUnit& unit: units) {
+                if (unit.exactFactor.den < 0)
+                    throw std::runtime_error("Damaged snapshot");
+                snapshot->units.push_back({ view(unit.category), view(unit.name), view(unit.symbol), view(unit.baseUnit),
+                                            unit.conversionFactor, unit.exactFactor });
+            }
+            index(unitSymbols, snapshot->unitSymbols, [&](UnitId id) { return snapshot->units[id].symbol; }, units.size());
+            index(unitNames, snapshot->unitNames, [&](UnitId id) { return snapshot->units[id].name; }, units.size());
+
+            const FactorMatrix& factors = snapshot->factors;
+            for (std::size_t i = 0; i < units.size(); ++i) {
+                std::uint32_t category = factors.categoryOf[i];
+                if (category >= factors.categorySize.size() || factors.position[i] >= factors.categorySize[category])
+                    throw std::runtime_error("Damaged snapshot");
+            }
+            for (std::size_t category = 0; category < factors.categorySize.size(); ++category) {
+                std::uint64_t size = factors.categorySize[category];
+                std::uint32_t start = factors.matrixStart[category];
+                if (start != noMatrix && (size > maxMatrixUnits || start + size * size > factors.matrix.size()))
+                    throw std::runtime_error("Damaged snapshot");
+            }
+
+            snapshot->constants.reserve(constants.size());
+            for (const StoredConstant& constant: constants) {
+                snapshot->constants.push_back({ view(constant.group), view(constant.name), view(constant.symbol),
+                                                view(constant.value), view(constant.unit) });
+            }
+            index(constantSymbols, snapshot->constantSymbols, [&](UnitId id) { return snapshot->constants[id].symbol; }, constants.size());
+            index(constantNames, snapshot->constantNames, [&](UnitId id) { return snapshot->constants[id].name; }, constants.size());
+        } catch (const std::runtime_error&) {
+            return nullptr;
+        }
+        return snapshot;
+    }
+}
+
+
+CatalogueFiles catalogueFiles(std::string_view searchPath) {
+    CatalogueFiles files;
+    while (!searchPath.empty()) {
+        std::string entry(searchPath.substr(0, searchPath.find(':')));
+        searchPath.remove_prefix(std::min(entry.size() + 1, searchPath.size()));
+        if (entry.empty())
+            continue;
+
+        std::error_code error;
+        if (!std::filesystem::is_directory(entry, error)) {
+            files.units.push_back(entry);
+            continue;
+        }
+        const std::filesystem::path directory(entry);
+        if (std::filesystem::exists(directory / "units.dat", error))
+            files.units.push_back((directory / "units.dat").string());
+        if (std::filesystem::exists(directory / "constants.dat", error))
+            files.constants.push_back((directory / "constants.dat").string());
+    }
+    return files;
+}
+
+
+std::filesystem::path snapshotDirectory() {
+    const char* cache = std::getenv("XDG_CACHE_HOME");
+    if (cache != nullptr && cache[0] != '\0')
+        return std::filesystem::path(cache) / "uc";
+    const char* home = std::getenv("HOME");
+    return (home != nullptr ? std::filesystem::path(home) : std::filesystem::current_path()) / ".cache" / "uc";
+}
+
+
+bool loadCatalogue(Units& u, Constants& c, const CatalogueFiles& files, const std::filesystem::path& cacheDirectory) {
+    const std::string stamped = stamps(files);
+    const std::filesystem::path snapshot = cacheDirectory.empty() ? std::filesystem::path() : snapshotPath(cacheDirectory, files);
+
+    Units units;
+    Constants constants;
+    if (!snapshot.empty()) {
+        if (std::shared_ptr<const Snapshot> loaded = readSnapshot(snapshot, stamped)) {
+            units.loadUnits({ loaded->units, loaded->unitSymbols, loaded->unitNames }, loaded->factors, loaded);
+            constants.loadConstants({ loaded->constants, loaded->constantSymbols, loaded->constantNames }, loaded);
+            u = std::move(units);
+            c = std::move(constants);
+            return true;
+        }
+    }
+
+    units.loadUnits(builtinUnits, builtinFactors);
+    constants.loadConstants(builtinConstants);
+    const std::string* loading = nullptr;
+    try {
+        for (const std::string& path: files.units) {
+            loading = &path;
+            units.loadUnitsFile(path);
+        }
+        for (const std::string& path: files.constants) {
+            loading = &path;
+            constants.loadConstantsFile(path);
+        }
+    } catch (const std::invalid_argument& e) {
+        throw std::runtime_error("Invalid table in " + *loading + ": " + e.what());
+    }
+
+    // The snapshot only saves time, so failing to write one is not an error
+    if (!snapshot.empty()) {
+        try {
+            saveSnapshot(snapshot, stamped, units, constants);
+        } catch (const std::exception&) {
+        }
+    }
+    u = std::move(units);
+    c = std::move(constants);
+    return false;
+}
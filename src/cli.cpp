@@ -0,0 +1,932 @@
+// cli.cpp: The uc command line: argument handling, listings and daemon mode
+#include <_ctype.h>
+#include <algorithm>
+#include <charconv>
+#include <csignal>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <optional>
+#include <span>
+#include <sstream>
+#include <stdexcept>
+#include <system_error>
+#include <vector>
+
+#include <unistd.h>
+
+#include "catalogue.hpp"
+#include "csv.hpp"
+#include "cli.hpp"
+#include "formula.hpp"
+#include "search.hpp"
+#include "stats.hpp"
+#include "unix_socket.hpp"
+
+
+bool isSwitch(const std::string& input) {
+    char firstChar = input.front();
+    return firstChar == '-' ? true : false;
+}
+
+
+std::string toUpper(const std::string& input) {
+    std::string upperStr = input;
+    std::transform(upperStr.begin(), upperStr.end(), upperStr.begin(), [](unsigned char c) {
+        return std::toupper(c);
+    });
+    return upperStr;
+}
+
+
+void listCategories(const Units& u, std::ostream& out) {
+    OutputBuffer output(out);
+    std::span<const UnitRecord> units = u.units();
+    std::span<const std::uint32_t> categoryOf = u.unitFactors().categoryOf;
+    // Categories are numbered in order of first appearance
+    std::uint32_t listed = 0;
+    for (std::size_t i = 0; i < units.size(); ++i) {
+        if (categoryOf[i] == listed) {
+            ++listed;
+            output << units[i].category << '\n';
+        }
+    }
+}
+
+
+void listUnits(const Units& u, const std::string& input, std::ostream& out) {
+    OutputBuffer output(out);
+    std::string category = toUpper(input);
+    std::span<const UnitRecord> units = u.units();
+    std::span<const std::uint32_t> categoryOf = u.unitFactors().categoryOf;
+    auto first = std::find_if(units.begin(), units.end(), [&](const UnitRecord& unit) { return unit.category == category; });
+    bool found = first != units.end();
+    if (found) {
+        // Compared by number rather than by name
+        const std::uint32_t id = categoryOf[static_cast<std::size_t>(first - units.begin())];
+        for (std::size_t i = static_cast<std::size_t>(first - units.begin()); i < units.size(); ++i) {
+            if (categoryOf[i] == id)
+                output.padded(units[i].name, 20).padded(units[i].symbol, 8) << '\n';
+        }
+    }
+    if (!found)
+        output << "Unknown category: " << input << didYouMean(SearchIndex(u).suggest(input, SearchKind::Category)) << '\n';
+}
+
+
+void listGroups(const Constants& c, std::ostream& out) {
+    OutputBuffer output(out);
+    for (std::string_view group: c.groups()) {
+        output.padded(group, 3) << '\n';
+    }
+}
+
+
+void listConstants(const Constants& c, const std::string& input, std::ostream& out) {
+    OutputBuffer output(out);
+    std::string group = toUpper(input);
+    std::span<const ConstantRecord> constants = c.constants();
+    std::span<const std::uint32_t> groupOf = c.groupIds();
+    auto first = std::find_if(constants.begin(), constants.end(), [&](const ConstantRecord& constant) { return constant.group == group; });
+    bool found = first != constants.end();
+    if (found) {
+        const std::uint32_t id = groupOf[static_cast<std::size_t>(first - constants.begin())];
+        for (std::size_t i = static_cast<std::size_t>(first - constants.begin()); i < constants.size(); ++i) {
+            if (groupOf[i] == id)
+                output.padded(constants[i].name, 31).padded(constants[i].symbol, 8) << '\n';
+        }
+    }
+    if (!found)
+        output << "Unknown group: " << input << didYouMean(SearchIndex(c).suggest(input, SearchKind::Group)) << '\n';
+}
+
+
+void listConstantsDetailed(const Constants& c, std::ostream& out) {
+    OutputBuffer output(out);
+    std::span<const ConstantRecord> constants = c.constants();
+    std::span<const std::uint32_t> groupOf = c.groupIds();
+    const std::size_t groups = c.groups().size();
+    for (std::uint32_t group = 0; group < groups; ++group) {
+        for (std::size_t i = 0; i < constants.size(); ++i) {
+            const ConstantRecord& constant = constants[i];
+            if (groupOf[i] == group) {
+                output.padded(constant.group, 16).padded(constant.name, 32).padded(constant.symbol, 12)
+                      .padded(constant.value, 20).padded(constant.unit, 20) << '\n';
+            }
+        }
+    }
+}
+
+
+void valueOfConstant(const Constants& c, const std::string& input, std::ostream& out) {
+    const ConstantRecord* constant = c.findConstant(input);
+    if (constant != nullptr) {
+        out << constant->value << std::endl;
+        return;
+    }
+    out << "Unknown constant: " << input << didYouMean(SearchIndex(c).suggest(input, SearchKind::Constant)) << std::endl;
+}
+
+
+void completeKeys(const Units& u, const Constants& c, const std::string& kind, const std::string& prefix, std::ostream& out) {
+    const SearchKind kinds[] = { SearchKind::Unit, SearchKind::Category, SearchKind::Constant, SearchKind::Group };
+    const std::string_view names[] = { "units", "categories", "constants", "groups" };
+    auto named = std::find(std::begin(names), std::end(names), kind);
+    if (named == std::end(names))
+        throw std::invalid_argument(kind);
+    SearchKind searched = kinds[named - std::begin(names)];
+    SearchIndex index = searched == SearchKind::Unit || searched == SearchKind::Category ? SearchIndex(u) : SearchIndex(c);
+
+    OutputBuffer output(out);
+    for (std::string_view key: index.complete(prefix, searched))
+        output << key << '\n';
+}
+
+
+// Suggestions for the first of unitFrom and unitTo that is neither a unit of u nor an
+// expression of them, as reported by convertValue
+std::string unknownUnitHint(const Units& u, std::string_view unitFrom, std::string_view unitTo) {
+    for (std::string_view unit: { unitFrom, unitTo }) {
+        if (u.findUnit(unit) != unknownUnit)
+            continue;
+        if (isUnitExpression(unit)) {
+            if (parseUnitExpression(u, unit))
+                continue;
+            return "";
+        }
+        return didYouMean(SearchIndex(u).suggest(unit, SearchKind::Unit));
+    }
+    return "";
+}
+
+
+void convertUnit(const Units& u, History& history, double amount, const std::string& unitFrom, const std::string& unitTo,
+                 const NumberFormat& format) {
+    double result;
+    try {
+        result = u.convertValue(amount, unitFrom, unitTo);
+    } catch (const std::invalid_argument& e) {
+        std::cout << e.what() << unknownUnitHint(u, unitFrom, unitTo) << std::endl;
+        return;
+    }
+    OutputBuffer(std::cout, format) << result << '\n';
+    history.append(amount, unitFrom, unitTo, result);
+}
+
+
+void convertUnitPrecise(const Units& u, History& history, const std::string& value, const std::string& unitFrom,
+                        const std::string& unitTo, bool exact, const NumberFormat& format) {
+    std::expected<double, libuc::Error> approximate = u.convert(0, unitFrom, unitTo);
+    if (!approximate) {
+        // Reported as convertUnit would
+        convertUnit(u, history, 0, unitFrom, unitTo);
+        return;
+    }
+
+    // The whole value must be a number: std::stod would take the 1 of 1/3
+    std::string_view number = value.starts_with('+') ? std::string_view(value).substr(1) : std::string_view(value);
+    double amount;
+    auto [end, ec] = std::from_chars(number.data(), number.data() + number.size(), amount);
+    if (ec == std::errc::result_out_of_range)
+        throw std::out_of_range(value);
+    if (ec != std::errc() || end != number.data() + number.size() || (value.starts_with('+') && number.starts_with('-')))
+        throw std::invalid_argument(value);
+    double recorded;
+    if (exact) {
+        // A number that parseRational rejects has more digits than it can hold
+        std::optional<Rational> exactAmount = parseRational(value);
+        if (!exactAmount)
+            throw std::out_of_range(value);
+        std::expected<Rational, libuc::Error> result = u.convertExact(*exactAmount, unitFrom, unitTo);
+        if (!result) {
+            std::cout << libuc::errorMessage(result.error()) << ": " << unitFrom << " to " << unitTo << std::endl;
+            return;
+        }
+        OutputBuffer(std::cout) << formatRational(*result) << '\n';
+        recorded = toDouble(*result);
+    } else {
+        std::expected<long double, libuc::Error> result = u.convertExtended(amount, unitFrom, unitTo);
+        if (!result) {
+            std::cout << libuc::errorMessage(result.error()) << ": " << unitFrom << " to " << unitTo << std::endl;
+            return;
+        }
+        OutputBuffer(std::cout, format) << *result << '\n';
+        recorded = static_cast<double>(*result);
+    }
+    history.append(amount, unitFrom, unitTo, recorded);
+}
+
+
+void evaluateFormula(const Units& u, const Constants& c, const std::string& text, const std::string& unitFrom,
+                     const std::string& unitTo, const NumberFormat& format) {
+    Formula formula;
+    try {
+        formula = compileFormula(u, c, text, unitFrom, unitTo);
+    } catch (const FormulaError& e) {
+        std::cout << e.what()
+                  << (!e.name.empty() ? didYouMean(SearchIndex(c).suggest(e.name, SearchKind::Constant))
+                                      : unknownUnitHint(u, unitFrom, unitTo))
+                  << std::endl;
+        return;
+    }
+    if (formula.takesInput())
+        evaluateLines(std::cin, std::cout, std::cerr, formula, format);
+    else
+        OutputBuffer(std::cout, format) << formula.evaluate() << '\n';
+}
+
+
+void appendMemoStats(const Units& u, std::string& out) {
+    const MemoStats memo = u.memoStats();
+    if (memo.capacity == 0)
+        return;
+    std::uint64_t lookups = memo.hits + memo.misses;
+    double rate = lookups == 0 ? 0 : 100.0 * static_cast<double>(memo.hits) / static_cast<double>(lookups);
+    out += std::format("{:<10}{:>12}{:>12}{:>12}{:>12}\n", "memo", "hits", "misses", "hit rate", "capacity");
+    out += std::format("{:<10}{:>12}{:>12}{:>11.1f}%{:>12}\n", "units", memo.hits, memo.misses, rate, memo.capacity);
+}
+
+
+bool serveRequest(std::string_view request, const Units& u, const Constants& c, std::string& response) {
+    static thread_local std::vector<std::string_view> fields;
+    splitFields(request, fields);
+    if (fields.empty()) {
+        response += "Empty request";
+        return false;
+    }
+
+    double amount;
+    if (fields.size() >= 3 && parseNumber(fields.front(), amount)) {
+        try {
+            appendNumber(response, convertFields(fields, u, nullptr, nullptr));
+            response.push_back('\n');
+            return true;
+        } catch (const std::invalid_argument& e) {
+            response += e.what();
+            return false;
+        }
+    }
+
+    std::string_view option = fields.front();
+    if (option.front() != '-') {
+        std::string_view name = request.substr(option.data() - request.data(),
+                                               fields.back().data() + fields.back().size() - option.data());
+        const ConstantRecord* constant = c.findConstant(name);
+        if (constant == nullptr) {
+            response += std::format("Unknown constant: {}", name);
+            return false;
+        }
+        response += constant->value;
+        response.push_back('\n');
+        return true;
+    }
+
+    // Timings and memo hits of the daemon since it started
+    if (option == "--stats" && fields.size() == 1) {
+        appendStats(response);
+        appendMemoStats(u, response);
+        return statsEnabled || u.memoStats().capacity != 0;
+    }
+
+    // A formula over constants, which has no input to give x
+    if (option == "--eval") {
+        if (fields.size() < 2) {
+            response += "Missing argument for --eval option.";
+            return false;
+        }
+        std::string_view text = request.substr(fields[1].data() - request.data(),
+                                               fields.back().data() + fields.back().size() - fields[1].data());
+        try {
+            Formula formula = compileFormula(u, c, text);
+            if (formula.takesInput()) {
+                response += std::format("No value for x in: {}", text);
+                return false;
+            }
+            appendNumber(response, formula.evaluate());
+            response.push_back('\n');
+            return true;
+        } catch (const FormulaError& e) {
+            response += e.what();
+            return false;
+        }
+    }
+
+    // Listings, with the argument count uc requires
+    const bool takesArgument = option == "-u" || option == "-C";
+    if (option != "-c" && option != "-u" && option != "-Cg" && option != "-Cd" && option != "-C") {
+        response += std::format("Unsupported request: {}", option);
+        return false;
+    }
+    if (fields.size() != (takesArgument ? 2u : 1u)) {
+        response += fields.size() < 2 ? std::format("Missing argument for {} option.", option)
+                                      : std::format("Unknown option: {}", fields[takesArgument ? 2 : 1]);
+        return false;
+    }
+    std::ostringstream out;
+    if (option == "-c")
+        listCategories(u, out);
+    else if (option == "-u")
+        listUnits(u, std::string(fields[1]), out);
+    else if (option == "-Cg")
+        listGroups(c, out);
+    else if (option == "-Cd")
+        listConstantsDetailed(c, out);
+    else
+        listConstants(c, std::string(fields[1]), out);
+    response += std::move(out).str();
+    return true;
+}
+
+
+std::size_t clientRequests(const std::string& socketPath, std::istream& in) {
+    UnixClient client(socketPath);
+    std::size_t failures = 0;
+    std::string requests, line;
+    auto send = [&]() {
+        client.exchange(requests, [&](bool ok, std::string_view payload) {
+            std::cout << payload;
+            if (!ok) {
+                std::cout << '\n';
+                ++failures;
+            }
+        });
+        requests.clear();
+    };
+
+    while (std::getline(in, line)) {
+        requests += line;
+        requests.push_back('\n');
+        if (requests.size() >= (1 << 20))
+            send();
+    }
+    send();
+    std::cout.flush();
+    return failures;
+}
+
+
+void printUsage() {
+    std::cout << "Usage: uc [OPTIONS] <value> <from_unit> <to_unit>" << std::endl;
+    std::cout << std::endl;
+    std::cout << "Options:" << std::endl;
+    std::cout << " -h, --help         Display this help message and exit" << std::endl;
+    std::cout << " -v, --version      Display version information and exit" << std::endl;
+    std::cout << " --complete <units|categories|constants|groups> [prefix]" << std::endl;
+    std::cout << "                    List the names starting with prefix, for shell completion" << std::endl;
+    std::cout << std::endl;
+    std::cout << " Units:" << std::endl;
+    std::cout << " -c                 Display available unit categories" << std::endl;
+    std::cout << " -u <category>      Display available units in the specified category" << std::endl;
+    std::cout << "                    Note: <category> is case agnostic" << std::endl;
+    std::cout << " --exact <value> <from_unit> <to_unit>" << std::endl;
+    std::cout << "                    Convert in exact rational arithmetic, printing every" << std::endl;
+    std::cout << "                    digit of the result" << std::endl;
+    std::cout << " --extended <value> <from_unit> <to_unit>" << std::endl;
+    std::cout << "                    Convert in long double arithmetic" << std::endl;
+    std::cout << std::endl;
+    std::cout << " Constants:" << std::endl;
+    std::cout << " -Cg                Display available constant groups" << std::endl;
+    std::cout << " -Cd                Display detailed view of all available constants" << std::endl;
+    std::cout << " -C <group>         Display available constants in the specified group" << std::endl;
+    std::cout << "                    Note: <group> is case agnostic" << std::endl;
+    std::cout << " --eval <formula> [<from_unit> <to_unit>]" << std::endl;
+    std::cout << "                    Evaluate arithmetic over constants, such as 2*pi*c, or over" << std::endl;
+    std::cout << "                    each value of stdin as x, converting the result if asked" << std::endl;
+    std::cout << std::endl;
+    std::cout << " Conversion history:" << std::endl;
+    std::cout << " --hist [n]         Display conversion history from all time, or its last n" << std::endl;
+    std::cout << "                    entries" << std::endl;
+    std::cout << " --hist-search <unit>" << std::endl;
+    std::cout << "                    Display conversions from or to unit" << std::endl;
+    std::cout << " --hist-range <start> [end]" << std::endl;
+    std::cout << "                    Display conversions made from start until end, each" << std::endl;
+    std::cout << "                    Unix seconds, YYYY-MM-DD[THH:MM[:SS]] or a time ago such" << std::endl;
+    std::cout << "                    as 30m, 12h or 7d" << std::endl;
+    std::cout << " --clrhist [n]      Clear conversion history, or all but its last n entries" << std::endl;
+    std::cout << std::endl;
+    std::cout << " Batch conversion:" << std::endl;
+    std::cout << " --batch [file]     Convert `<value> <from_unit> <to_unit>` lines read from" << std::endl;
+    std::cout << "                    file, or stdin if no file is given" << std::endl;
+    std::cout << " --batch <from_unit> <to_unit> [file]" << std::endl;
+    std::cout << "                    Convert a column of values from file or stdin" << std::endl;
+    std::cout << " --batch-file [<from_unit> <to_unit>] <file>" << std::endl;
+    std::cout << "                    As --batch, reading file through a memory map" << std::endl;
+    std::cout << " --binary [--f32] <from_unit> <to_unit>" << std::endl;
+    std::cout << "                    Convert raw little-endian float64 values (float32 with" << std::endl;
+    std::cout << "                    --f32) from stdin to stdout" << std::endl;
+    std::cout << " --binary --header [to_unit]" << std::endl;
+    std::cout << "                    As --binary, taking the units and width from a header" << std::endl;
+    std::cout << " --csv [--tsv] [--header] --col <n>:<from_unit>:<to_unit> [--col ...] [file]" << std::endl;
+    std::cout << "                    Convert column n (from 1) of CSV, or TSV with --tsv, from" << std::endl;
+    std::cout << "                    file or stdin, copying other columns and a header row" << std::endl;
+    std::cout << " --batch --jobs <n> ...  Convert blocks of lines on n threads (0 for one per" << std::endl;
+    std::cout << "                    core); output keeps the input order" << std::endl;
+    std::cout << " --batch --record ...  Append the batch's conversions to the history, one" << std::endl;
+    std::cout << "                    locked write per block" << std::endl;
+    std::cout << std::endl;
+    std::cout << " Daemon mode:" << std::endl;
+    std::cout << " --serve <socket>   Keep units and constants loaded and answer conversion," << std::endl;
+    std::cout << "                    constant and listing requests on a Unix socket" << std::endl;
+    std::cout << " --client <socket> [request...]" << std::endl;
+    std::cout << "                    Send a request, or each line of stdin, to a daemon" << std::endl;
+    std::cout << std::endl;
+    std::cout << " Unit files (before other options):" << std::endl;
+    std::cout << " --units-file <file>  Load units laid out like data/units.dat, overriding" << std::endl;
+    std::cout << "                    built-in units with the same symbol or name" << std::endl;
+    std::cout << " --constants-file <file>" << std::endl;
+    std::cout << "                    Load constants laid out like data/constants.dat" << std::endl;
+    std::cout << "                    UC_UNITS_PATH may also list unit files and directories" << std::endl;
+    std::cout << "                    holding units.dat and constants.dat, separated by ':'" << std::endl;
+    std::cout << std::endl;
+    std::cout << " Output format, memo, history and statistics (before other options):" << std::endl;
+    std::cout << " --precision <n>    Print results with n decimals (default 4)" << std::endl;
+    std::cout << " --scientific       Print results in scientific notation" << std::endl;
+    std::cout << " --shortest         Print the fewest digits that read back as the result" << std::endl;
+    std::cout << " --stats            Print the time spent parsing, looking up, converting," << std::endl;
+    std::cout << "                    formatting and loading to stderr (builds with UC_STATS=1)," << std::endl;
+    std::cout << "                    and memo hits and misses" << std::endl;
+    std::cout << " --memo <n>         Remember up to n results for conversions repeated in a" << std::endl;
+    std::cout << "                    batch or by a daemon" << std::endl;
+    std::cout << " --history-mode <async|drop|sync>" << std::endl;
+    std::cout << "                    Write the history of recorded batches on a background" << std::endl;
+    std::cout << "                    thread, waiting (async, the default) or dropping entries" << std::endl;
+    std::cout << "                    (drop) when it falls behind, or in line with each" << std::endl;
+    std::cout << "                    conversion (sync)" << std::endl;
+}
+
+
+int uc(int argc, char* argv[], Units& u, Constants& c) {
+    // EXIT_FAILURE once a daemon has answered a request with an error
+    int status = EXIT_SUCCESS;
+    // With --stats, the timings are printed to stderr however uc returns, after the
+    // history is written and without touching the results on stdout
+    struct StatsReport {
+        const Units& u;
+        bool requested = false;
+
+        ~StatsReport() {
+            if (!requested)
+                return;
+            std::string report;
+            appendStats(report);
+            appendMemoStats(u, report);
+            std::cerr << report;
+        }
+    } statsReport{ u };
+    // A single conversion appends its entry directly. Recorded batches append on a
+    // background thread, waiting or dropping entries as overflow says, unless
+    // --history-mode sync is given, and write what is queued before uc returns.
+    History history;
+    bool writeBehind = true;
+    HistoryOverflow overflow = HistoryOverflow::Block;
+
+    // Load the unit and constant files of UC_UNITS_PATH and of leading --units-file and
+    // --constants-file options, take leading output format, --memo, --history-mode and --stats
+    // options, then handle the remaining arguments
+    const char* searchPath = std::getenv("UC_UNITS_PATH");
+    CatalogueFiles files = catalogueFiles(searchPath != nullptr ? searchPath : "");
+    std::optional<NumberFormat> format;
+    std::size_t memo = 0;
+    std::vector<char*> args(argv, argv + argc);
+    while (args.size() >= 2) {
+        if (strcmp(args[1], "--stats") == 0) {
+            statsReport.requested = true;
+            args.erase(args.begin() + 1);
+            continue;
+        }
+        if (strcmp(args[1], "--scientific") == 0 || strcmp(args[1], "--shortest") == 0) {
+            format = { strcmp(args[1], "--scientific") == 0 ? NumberStyle::Scientific : NumberStyle::Shortest,
+                       format.value_or(NumberFormat()).precision };
+            args.erase(args.begin() + 1);
+            continue;
+        }
+        if (strcmp(args[1], "--units-file") != 0 && strcmp(args[1], "--constants-file") != 0
+            && strcmp(args[1], "--precision") != 0 && strcmp(args[1], "--memo") != 0
+            && strcmp(args[1], "--history-mode") != 0)
+            break;
+        if (args.size() < 3) {
+            std::cout << "Missing argument for " << args[1] << " option." << std::endl;
+            printUsage();
+            return status;
+        }
+        if (strcmp(args[1], "--precision") == 0) {
+            int precision;
+            auto [ptr, ec] = std::from_chars(args[2], args[2] + strlen(args[2]), precision);
+            if (ec != std::errc() || *ptr != '\0' || precision < 0 || precision > maxNumberPrecision) {
+                std::cout << "Invalid argument: " << args[2] << " is not a precision from 0 to "
+                          << maxNumberPrecision << "." << std::endl;
+                printUsage();
+                return status;
+            }
+            format = { format.value_or(NumberFormat()).style, precision };
+        } else if (strcmp(args[1], "--memo") == 0) {
+            auto [ptr, ec] = std::from_chars(args[2], args[2] + strlen(args[2]), memo);
+            if (ec != std::errc() || *ptr != '\0') {
+                std::cout << "Invalid argument: " << args[2] << " is not a valid memo size." << std::endl;
+                printUsage();
+                return status;
+            }
+        } else if (strcmp(args[1], "--history-mode") == 0) {
+            if (strcmp(args[2], "async") == 0 || strcmp(args[2], "drop") == 0) {
+                writeBehind = true;
+                overflow = strcmp(args[2], "drop") == 0 ? HistoryOverflow::Drop : HistoryOverflow::Block;
+            } else if (strcmp(args[2], "sync") == 0) {
+                writeBehind = false;
+            } else {
+                std::cout << "Invalid argument: " << args[2] << " is not async, drop or sync." << std::endl;
+                printUsage();
+                return status;
+            }
+        } else {
+            (strcmp(args[1], "--units-file") == 0 ? files.units : files.constants).push_back(args[2]);
+        }
+        args.erase(args.begin() + 1, args.begin() + 3);
+    }
+    if (!files.empty()) {
+        try {
+            loadCatalogue(u, c, files, snapshotDirectory());
+        } catch (const std::exception& e) {
+            std::cout << e.what() << std::endl;
+            return status;
+        }
+    }
+    // After loading, which forgets memos
+    if (memo != 0)
+        u.memoize(memo);
+    argc = static_cast<int>(args.size());
+    argv = args.data();
+
+    // Check for arguments
+    if (argc == 1) {
+        std::cout << "No arguments provided." << std::endl;
+        printUsage();
+        return status;
+    }
+    // Show help/program usage
+    if (strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "--help") == 0) {
+        printUsage();
+    }
+    // Show version number
+    else if (strcmp(argv[1], "-v") == 0 || strcmp(argv[1], "--version") == 0) {
+        std::cout << "Version 1.0" << std::endl;
+    }
+    // Show conversion history, or its last n entries
+    else if ((argc == 2 || argc == 3) && (strcmp(argv[1], "--hist") == 0 || strcmp(argv[1], "--clrhist") == 0)) {
+        const bool clear = strcmp(argv[1], "--clrhist") == 0;
+        if (argc == 2) {
+            clear ? history.clear() : history.display();
+            return status;
+        }
+        std::uint64_t count;
+        auto [ptr, ec] = std::from_chars(argv[2], argv[2] + strlen(argv[2]), count);
+        if (ec != std::errc() || *ptr != '\0') {
+            std::cout << "Invalid argument: " << argv[2] << " is not a valid number of entries." << std::endl;
+            printUsage();
+            return status;
+        }
+        clear ? history.compact(count) : history.tail(count);
+    }
+    // Show the conversion history of a unit
+    else if (strcmp(argv[1], "--hist-search") == 0) {
+        if (argc != 3) {
+            std::cout << (argc < 3 ? "Missing argument for --hist-search option." : std::string("Unknown option: ") + argv[3]) << std::endl;
+            printUsage();
+            return status;
+        }
+        history.search(argv[2]);
+    }
+    // Show the conversion history of a time range
+    else if (strcmp(argv[1], "--hist-range") == 0) {
+        if (argc < 3 || argc > 4) {
+            std::cout << (argc < 3 ? "Missing argument for --hist-range option." : std::string("Unknown option: ") + argv[4]) << std::endl;
+            printUsage();
+            return status;
+        }
+        std::optional<std::int64_t> start = History::parseTime(argv[2]);
+        std::optional<std::int64_t> end = argc == 4 ? History::parseTime(argv[3]) : std::numeric_limits<std::int64_t>::max();
+        if (!start || !end) {
+            std::cout << "Invalid time: " << (!start ? argv[2] : argv[3]) << std::endl;
+            printUsage();
+            return status;
+        }
+        history.range(*start, *end);
+    }
+    // Answer requests on a Unix socket until interrupted
+    else if (strcmp(argv[1], "--serve") == 0) {
+        if (argc != 3) {
+            std::cout << (argc < 3 ? "Missing argument for --serve option." : std::string("Unknown option: ") + argv[3]) << std::endl;
+            printUsage();
+            return status;
+        }
+        try {
+            static UnixServer* running = nullptr;
+            UnixServer server(argv[2]);
+            running = &server;
+            auto stop = [](int) { running->stop(); };
+            std::signal(SIGINT, stop);
+            std::signal(SIGTERM, stop);
+            server.run([&u, &c](std::string_view request, std::string& response) {
+                return serveRequest(request, u, c, response);
+            });
+            std::signal(SIGINT, SIG_DFL);
+            std::signal(SIGTERM, SIG_DFL);
+            running = nullptr;
+        } catch (const std::exception& e) {
+            std::cout << e.what() << std::endl;
+        }
+    }
+    // Send a request, or lines of stdin, to a daemon started with --serve
+    else if (strcmp(argv[1], "--client") == 0) {
+        if (argc < 3) {
+            std::cout << "Missing argument for --client option." << std::endl;
+            printUsage();
+            return status;
+        }
+        try {
+            std::signal(SIGPIPE, SIG_IGN);
+            std::string request;
+            for (int arg = 3; arg < argc; ++arg)
+                request += (arg == 3 ? "" : " ") + std::string(argv[arg]);
+            std::istringstream arguments(request);
+            if (clientRequests(argv[2], argc == 3 ? std::cin : arguments) != 0)
+                status = EXIT_FAILURE;
+        } catch (const std::exception& e) {
+            std::cout << e.what() << std::endl;
+        }
+    }
+    // Convert lines from a file or stdin
+    else if (strcmp(argv[1], "--batch") == 0 || strcmp(argv[1], "--batch-file") == 0) {
+        const bool mapped = strcmp(argv[1], "--batch-file") == 0;
+        int arg = 2;
+        unsigned jobs = 1;
+        bool record = false;
+        while (arg < argc && (strcmp(argv[arg], "--jobs") == 0 || strcmp(argv[arg], "--record") == 0)) {
+            if (strcmp(argv[arg], "--record") == 0) {
+                record = true;
+                ++arg;
+                continue;
+            }
+            if (arg + 1 >= argc) {
+                std::cout << "Missing argument for --jobs option." << std::endl;
+                printUsage();
+                return status;
+            }
+            const char* count = argv[arg + 1];
+            auto [ptr, ec] = std::from_chars(count, count + strlen(count), jobs);
+            if (ec != std::errc() || *ptr != '\0') {
+                std::cout << "Invalid argument: " << count << " is not a valid number of jobs." << std::endl;
+                printUsage();
+                return status;
+            }
+            arg += 2;
+        }
+        int positional = argc - arg;
+        if (positional > 3) {
+            std::cout << "Unknown option: " << argv[arg + 3] << std::endl;
+            printUsage();
+            return status;
+        }
+        if (mapped && positional != 1 && positional != 3) {
+            std::cout << "Missing argument for --batch-file option." << std::endl;
+            printUsage();
+            return status;
+        }
+        std::string unitFrom = positional >= 2 ? argv[arg] : "";
+        std::string unitTo = positional >= 2 ? argv[arg + 1] : "";
+        std::string inputPath = positional == 1 ? argv[arg] : positional == 3 ? argv[arg + 2] : "";
+
+        if (record && writeBehind)
+            history.writeBehind(HistoryWriter::defaultCapacity, overflow);
+        try {
+            if (mapped) {
+                convertMappedFile(inputPath, STDOUT_FILENO, u, unitFrom, unitTo, jobs, record ? &history : nullptr,
+                                  format.value_or(NumberFormat()));
+                return status;
+            }
+
+            std::ifstream inputFile;
+            if (!inputPath.empty()) {
+                inputFile.open(inputPath, std::ios::binary);
+                if (!inputFile.is_open()) {
+                    std::cout << "Unable to open file: " << inputPath << std::endl;
+                    return status;
+                }
+            }
+            std::istream& in = inputPath.empty() ? std::cin : inputFile;
+            convertBatch(in, std::cout, u, unitFrom, unitTo, jobs, record ? &history : nullptr, format.value_or(NumberFormat()));
+        } catch (const std::exception& e) {
+            std::cout << e.what() << std::endl;
+        }
+    }
+    // Convert a binary column from stdin to stdout
+    else if (strcmp(argv[1], "--binary") == 0) {
+        int arg = 2;
+        std::size_t width = 8;
+        bool header = false;
+        for (; arg < argc && isSwitch(argv[arg]); ++arg) {
+            if (strcmp(argv[arg], "--f32") == 0)
+                width = 4;
+            else if (strcmp(argv[arg], "--header") == 0)
+                header = true;
+            else {
+                std::cout << "Unknown option: " << argv[arg] << std::endl;
+                printUsage();
+                return status;
+            }
+        }
+        int positional = argc - arg;
+        if (positional > 2 || (!header && positional != 2)) {
+            std::cout << (positional > 2 ? "Unknown option: " + std::string(argv[arg + 2]) : "Missing units for --binary option.") << std::endl;
+            printUsage();
+            return status;
+        }
+        std::string unitFrom = positional == 2 ? argv[arg] : "";
+        std::string unitTo = positional == 2 ? argv[arg + 1] : positional == 1 ? argv[arg] : "";
+
+        try {
+            std::cout.flush();
+            convertBinary(STDIN_FILENO, STDOUT_FILENO, u, header ? "" : unitFrom, unitTo, width, header);
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+        }
+    }
+    // Convert columns of CSV or TSV from a file or stdin
+    else if (strcmp(argv[1], "--csv") == 0) {
+        char delimiter = ',';
+        bool header = false;
+        std::vector<CsvColumn> columns;
+        int arg = 2;
+        for (; arg < argc && isSwitch(argv[arg]); ++arg) {
+            if (strcmp(argv[arg], "--tsv") == 0)
+                delimiter = '\t';
+            else if (strcmp(argv[arg], "--header") == 0)
+                header = true;
+            else if (strcmp(argv[arg], "--col") == 0) {
+                if (++arg >= argc) {
+                    std::cout << "Missing argument for --col option." << std::endl;
+                    printUsage();
+                    return status;
+                }
+                try {
+                    columns.push_back(parseCsvColumn(u, argv[arg]));
+                } catch (const std::invalid_argument& e) {
+                    // The units are the spec's second and third parts
+                    std::string_view spec = argv[arg];
+                    std::string_view units = spec.substr(std::min(spec.find(':') + 1, spec.size()));
+                    std::size_t split = std::min(units.find(':'), units.size());
+                    std::cout << e.what() << unknownUnitHint(u, units.substr(0, split), units.substr(std::min(split + 1, units.size())))
+                              << std::endl;
+                    return status;
+                }
+            } else {
+                std::cout << "Unknown option: " << argv[arg] << std::endl;
+                printUsage();
+                return status;
+            }
+        }
+        if (columns.empty() || argc - arg > 1) {
+            std::cout << (columns.empty() ? "Missing --col option for --csv." : "Unknown option: " + std::string(argv[arg + 1]))
+                      << std::endl;
+            printUsage();
+            return status;
+        }
+
+        try {
+            CsvConverter converter(std::move(columns), delimiter, header, format.value_or(NumberFormat()));
+            std::ifstream inputFile;
+            if (arg < argc) {
+                inputFile.open(argv[arg], std::ios::binary);
+                if (!inputFile.is_open()) {
+                    std::cout << "Unable to open file: " << argv[arg] << std::endl;
+                    return status;
+                }
+            }
+            convertCsv(arg < argc ? inputFile : std::cin, std::cout, converter);
+        } catch (const std::exception& e) {
+            std::cout << e.what() << std::endl;
+        }
+    }
+    // Evaluate a formula over constants, or over each value of stdin if it uses x
+    else if (strcmp(argv[1], "--eval") == 0) {
+        if (argc != 3 && argc != 5) {
+            std::cout << (argc < 3 ? "Missing argument for --eval option." : argc == 4 ? "Missing target unit for --eval option."
+                                                                                        : std::string("Unknown option: ") + argv[5])
+                      << std::endl;
+            printUsage();
+            return status;
+        }
+        evaluateFormula(u, c, argv[2], argc == 5 ? argv[3] : "", argc == 5 ? argv[4] : "", format.value_or(NumberFormat()));
+    }
+    // List constants groups
+    else if (strcmp(argv[1], "-Cg") == 0) {
+        if (argc == 2)
+            listGroups(c, std::cout);
+        else {
+            std::cout << "Unknown option: " << argv[2] << std::endl;
+            printUsage();
+        }
+    }
+    // List constants for specfied group
+    else if (strcmp(argv[1], "-C") == 0) {
+        if (argc == 3)
+            listConstants(c, argv[2], std::cout);
+        else if (argc < 3) {
+            std::cout << "Missing argument for -C option." << std::endl;
+            printUsage();}
+        else {
+            std::cout << "Unknown option: " << argv[3] << std::endl;
+            printUsage();
+        }
+    }
+    // List all details for all constants
+    else if (strcmp(argv[1], "-Cd") == 0) {
+        if (argc == 2)
+            listConstantsDetailed(c, std::cout);
+        else {
+            std::cout << "Unknown option: " << argv[2] << std::endl;
+            printUsage();
+        }
+    }
+    // Show value of valid constant provided
+    else if (argc == 2 && !isSwitch(argv[1])) {
+        try {
+            valueOfConstant(c, argv[1], std::cout);
+        } catch (const std::invalid_argument& e) {
+            printUsage();
+        }
+    }
+    // List unit categories
+    else if (strcmp(argv[1], "-c") == 0) {
+        if (argc == 2)
+            listCategories(u, std::cout);
+        else {
+            std::cout << "Unknown option: " << argv[2] << std::endl;
+            printUsage();
+        }
+    }
+    // Complete a unit, category, constant or group name, for shell completion
+    else if (strcmp(argv[1], "--complete") == 0) {
+        if (argc < 3 || argc > 4) {
+            std::cout << (argc < 3 ? "Missing argument for --complete option." : std::string("Unknown option: ") + argv[4]) << std::endl;
+            printUsage();
+            return status;
+        }
+        try {
+            completeKeys(u, c, argv[2], argc == 4 ? argv[3] : "", std::cout);
+        } catch (const std::invalid_argument& e) {
+            std::cout << "Invalid argument: " << argv[2] << " is not units, categories, constants or groups." << std::endl;
+            printUsage();
+        }
+    }
+    // List units for specified category
+    else if (strcmp(argv[1], "-u") == 0) {
+        if (argc == 3)
+            listUnits(u, argv[2], std::cout);
+        else if (argc < 3) {
+            std::cout << "Missing argument for -u option." << std::endl;
+            printUsage();
+        } else {
+            std::cout << "Unknown option: " << argv[3] << std::endl;
+            printUsage();
+        }
+    }
+    // Convert valid statement in exact or long double arithmetic
+    else if (argc == 5 && (strcmp(argv[1], "--exact") == 0 || strcmp(argv[1], "--extended") == 0)) {
+        try {
+            convertUnitPrecise(u, history, argv[2], argv[3], argv[4], strcmp(argv[1], "--exact") == 0,
+                               format.value_or(NumberFormat{ NumberStyle::Shortest }));
+        } catch (const std::invalid_argument& e) {
+            std::cout << "Invalid argument: " << argv[2] << " is not a valid number." << std::endl;
+            printUsage();
+        } catch (const std::out_of_range& e) {
+            std::cout << "Out of range: " << argv[2] << " has too many digits or is too large." << std::endl;
+            printUsage();
+        } catch (const std::range_error& e) {
+            std::cout << e.what() << ": " << argv[2] << " " << argv[3] << " to " << argv[4] << std::endl;
+        }
+    }
+    // Convert valid statement
+    else if (argc == 4) {
+        try {
+            double amount = std::stod(argv[1]);
+            std::string unitFrom = argv[2];
+            std::string unitTo = argv[3];
+            convertUnit(u, history, amount, unitFrom, unitTo, format.value_or(NumberFormat()));
+        } catch (const std::invalid_argument& e) {
+            std::cout << "Invalid argument: " << argv[1] << " is not a valid number." << std::endl;
+            printUsage();
+        } catch (const std::out_of_range& e) {
+            std::cout << "Out of range: " << argv[1] << " is too large or too small." << std::endl;
+            printUsage();
+        } catch (const std::range_error& e) {
+            std::cout << e.what() << ": " << argv[1] << " " << argv[2] << " to " << argv[3] << std::endl;
+        }
+    } else {
+        std::cout << "Unknown or incomplete option." << std::endl;
+        printUsage();
+    }
+    return status;
+}
@@ -0,0 +1,120 @@
+// constants.cpp: Constant lookup
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <limits>
+#include <system_error>
+
+#include "libuc.hpp"
+#include "mapped_file.hpp"
+
+
+std::expected<double, libuc::Error> libuc::constant(std::string_view input) noexcept {
+    static const Constants builtin = [] {
+        Constants constants;
+        constants.loadConstants(builtinConstants);
+        return constants;
+    }();
+    return builtin.value(input);
+}
+
+
+void Constants::loadConstants(const Table<ConstantRecord>& constants, std::shared_ptr<const void> keepAlive) {
+    UC_STATS_SCOPE(Stage::Load);
+    table = constants;
+    tableEnds.clear();
+    storage.clear();
+    if (keepAlive != nullptr)
+        storage.push_back(std::move(keepAlive));
+
+    auto owned = std::make_shared<Arena>(columnBytes(table.records.size()));
+    fillColumns(*owned);
+    arena = std::move(owned);
+}
+
+
+void Constants::loadConstants(std::string_view lOC) {
+    UC_STATS_SCOPE(Stage::Load);
+    std::vector<ConstantRecord> records(table.records.begin(), table.records.end());
+    if (tableEnds.empty())
+        tableEnds.assign(1, records.size());
+    forEachRow(lOC, [&](std::string_view line) { records.push_back(parseConstantRow(line)); });
+    tableEnds.push_back(records.size());
+
+    const std::size_t slots = indexCapacity(records.size());
+    auto owned = std::make_shared<Arena>(Arena::bytes<ConstantRecord>(records.size()) + 2 * Arena::bytes<IndexSlot>(slots)
+                                         + columnBytes(records.size()));
+    std::span<ConstantRecord> ownedRecords = owned->allocate<ConstantRecord>(records.size());
+    std::copy(records.begin(), records.end(), ownedRecords.begin());
+    std::span<IndexSlot> symbolIndex = owned->allocate<IndexSlot>(slots);
+    std::span<IndexSlot> nameIndex = owned->allocate<IndexSlot>(slots);
+
+    // Each table is indexed first-wins, over the tables before it
+    std::size_t start = 0;
+    for (std::size_t end: tableEnds) {
+        std::span<const ConstantRecord> rows = std::span<const ConstantRecord>(ownedRecords).subspan(start, end - start);
+        fillIndex<ConstantRecord>(symbolIndex, rows, &ConstantRecord::symbol, false, true, static_cast<UnitId>(start));
+        fillIndex<ConstantRecord>(nameIndex, rows, &ConstantRecord::name, true, true, static_cast<UnitId>(start));
+        start = end;
+    }
+    table = { ownedRecords, symbolIndex, nameIndex };
+    fillColumns(*owned);
+    arena = std::move(owned);
+}
+
+
+void Constants::fillColumns(Arena& owned) {
+    std::span<const ConstantRecord> records = table.records;
+    std::span<double> numbers = owned.allocate<double>(records.size());
+    std::span<std::uint32_t> groups = owned.allocate<std::uint32_t>(records.size());
+    for (std::size_t i = 0; i < records.size(); ++i) {
+        std::string_view text = records[i].value;
+        auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), numbers[i]);
+        if (ec != std::errc() || ptr != text.data() + text.size())
+            numbers[i] = std::numeric_limits<double>::quiet_NaN();
+    }
+    groupCount = numberKeys<ConstantRecord>(records, &ConstantRecord::group, groups);
+    values = numbers;
+    groupOf = groups;
+}
+
+
+void Constants::loadConstantsFile(const std::string& path) {
+    auto file = std::make_shared<const MappedFile>(path);
+    loadConstants(file->view());
+    storage.push_back(std::move(file));
+}
+
+
+std::vector<std::string_view> Constants::groups() const {
+    // Groups are numbered in order of first appearance
+    std::vector<std::string_view> listed;
+    listed.reserve(groupCount);
+    for (std::size_t i = 0; i < table.records.size() && listed.size() < groupCount; ++i) {
+        if (groupOf[i] == listed.size())
+            listed.push_back(table.records[i].group);
+    }
+    return listed;
+}
+
+
+const ConstantRecord* Constants::findConstant(std::string_view input) const noexcept {
+    UC_STATS_SCOPE(Stage::Lookup);
+    UnitId bySymbol = findKey(table.symbolIndex, input, false);
+    UnitId byName = findKey(table.nameIndex, input, true);
+    // Records of later tables come later, so as for units the later match wins, whether
+    // by symbol or by name
+    UnitId id = bySymbol == unknownUnit ? byName : byName == unknownUnit ? bySymbol : std::max(bySymbol, byName);
+    return id == unknownUnit ? nullptr : &table.records[id];
+}
+
+
+std::expected<double, libuc::Error> Constants::value(std::string_view input) const noexcept {
+    const ConstantRecord* constant = findConstant(input);
+    if (constant == nullptr)
+        return std::unexpected(libuc::Error::UnknownConstant);
+    double number = values[static_cast<std::size_t>(constant - table.records.data())];
+    if (std::isnan(number))
+        return std::unexpected(libuc::Error::InvalidValue);
+    return number;
+}
@@ -0,0 +1,263 @@
+// conversions.cpp: Unit lookup and conversion
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+#include "expressions.hpp"
+#include "libuc.hpp"
+#include "mapped_file.hpp"
+#include "simd.hpp"
+
+
+std::string_view libuc::errorMessage(Error error) noexcept {
+    switch (error) {
+        case Error::UnknownFromUnit: return "Unknown source unit";
+        case Error::UnknownToUnit: return "Unknown target unit";
+        case Error::IncompatibleUnits: return "Incompatible units";
+        case Error::UnknownConstant: return "Unknown constant";
+        case Error::InvalidValue: return "Invalid value";
+        case Error::NotExact: return "No exact conversion";
+    }
+    return "Unknown error";
+}
+
+
+std::expected<double, libuc::Error> libuc::convert(double amount, std::string_view unitFrom,
+                                                   std::string_view unitTo) noexcept {
+    static const Units builtin = [] {
+        Units units;
+        units.loadUnits(builtinUnits, builtinFactors);
+        return units;
+    }();
+    return builtin.convert(amount, unitFrom, unitTo);
+}
+
+
+void Units::loadUnits(const Table<UnitRecord>& units, const FactorMatrix& unitFactors,
+                      std::shared_ptr<const void> keepAlive) {
+    UC_STATS_SCOPE(Stage::Load);
+    table = units;
+    factors = unitFactors;
+    arena = nullptr;
+    storage.clear();
+    plans.clear();
+    memo.clear();
+    if (keepAlive != nullptr)
+        storage.push_back(std::move(keepAlive));
+}
+
+
+void Units::loadUnits(std::string_view lOU) {
+    UC_STATS_SCOPE(Stage::Load);
+    // Parsed first, as the size of the factor matrix depends on the units' categories
+    std::vector<UnitRecord> records(table.records.begin(), table.records.end());
+    forEachRow(lOU, [&](std::string_view line) { records.push_back(parseUnitRow(line)); });
+    const std::size_t slots = indexCapacity(records.size());
+    auto [categories, entries] = factorMatrixSize(records);
+
+    auto owned = std::make_shared<Arena>(Arena::bytes<UnitRecord>(records.size()) + 2 * Arena::bytes<IndexSlot>(slots)
+                                         + 2 * Arena::bytes<std::uint32_t>(records.size())
+                                         + 2 * Arena::bytes<std::uint32_t>(categories) + Arena::bytes<Conversion>(entries));
+    std::span<UnitRecord> ownedRecords = owned->allocate<UnitRecord>(records.size());
+    std::copy(records.begin(), records.end(), ownedRecords.begin());
+    std::span<IndexSlot> symbolIndex = owned->allocate<IndexSlot>(slots);
+    std::span<IndexSlot> nameIndex = owned->allocate<IndexSlot>(slots);
+    fillIndex<UnitRecord>(symbolIndex, ownedRecords, &UnitRecord::symbol, false, false);
+    fillIndex<UnitRecord>(nameIndex, ownedRecords, &UnitRecord::name, true, false);
+    table = { ownedRecords, symbolIndex, nameIndex };
+
+    std::span<std::uint32_t> categoryOf = owned->allocate<std::uint32_t>(records.size());
+    std::span<std::uint32_t> position = owned->allocate<std::uint32_t>(records.size());
+    std::span<std::uint32_t> categorySize = owned->allocate<std::uint32_t>(categories);
+    std::span<std::uint32_t> matrixStart = owned->allocate<std::uint32_t>(categories);
+    std::span<Conversion> matrix = owned->allocate<Conversion>(entries);
+    fillFactorMatrix(ownedRecords, categoryOf, position, categorySize, matrixStart, matrix);
+    factors = { categoryOf, position, categorySize, matrixStart, matrix };
+    arena = std::move(owned);
+    plans.clear();
+    memo.clear();
+}
+
+
+void Units::loadUnitsFile(const std::string& path) {
+    auto file = std::make_shared<const MappedFile>(path);
+    loadUnits(file->view());
+    storage.push_back(std::move(file));
+}
+
+
+UnitId Units::findUnit(std::string_view unit) const noexcept {
+    UC_STATS_SCOPE(Stage::Lookup);
+    UnitId bySymbol = findKey(table.symbolIndex, unit, false);
+    UnitId byName = findKey(table.nameIndex, unit, true);
+    if (bySymbol == unknownUnit)
+        return byName;
+    if (byName == unknownUnit)
+        return bySymbol;
+    return std::max(bySymbol, byName);
+}
+
+
+Conversion Units::conversion(UnitId from, UnitId to) const noexcept {
+    std::uint32_t category = factors.categoryOf[from];
+    std::uint32_t start = factors.matrixStart[category];
+    if (start == noMatrix)
+        return composeConversion(baseConversion(table.records[from]), baseConversion(table.records[to]));
+    return factors.matrix[start + factors.position[from] * factors.categorySize[category] + factors.position[to]];
+}
+
+
+void Units::convertSpan(std::span<const double> in, std::span<double> out, UnitId from, UnitId to) const {
+    if (in.size() != out.size())
+        throw std::invalid_argument("Input and output sizes differ");
+    if (from >= table.records.size() || to >= table.records.size())
+        throw std::invalid_argument("Unknown unit id");
+    if (!convertible(from, to))
+        throw std::invalid_argument("Cannot convert between: " + std::string(table.records[from].symbol)
+                                    + " and " + std::string(table.records[to].symbol));
+
+    convertSpan(in, out, conversion(from, to));
+}
+
+
+void Units::convertSpan(std::span<const double> in, std::span<double> out, const Conversion& c) const {
+    UC_STATS_SCOPE(Stage::Convert);
+    if (in.size() != out.size())
+        throw std::invalid_argument("Input and output sizes differ");
+    affineTransform(in.data(), out.data(), in.size(), c.scale, c.offset);
+}
+
+
+std::expected<Conversion, libuc::Error> Units::plan(std::string_view unitFrom, std::string_view unitTo) const {
+    UnitId from = findUnit(unitFrom);
+    UnitId to = findUnit(unitTo);
+    if (from != unknownUnit && to != unknownUnit) {
+        if (!convertible(from, to))
+            return std::unexpected(libuc::Error::IncompatibleUnits);
+        return conversion(from, to);
+    }
+    if (from == unknownUnit && !isUnitExpression(unitFrom))
+        return std::unexpected(libuc::Error::UnknownFromUnit);
+    if (to == unknownUnit && !isUnitExpression(unitTo))
+        return std::unexpected(libuc::Error::UnknownToUnit);
+
+    if (std::optional<std::expected<Conversion, libuc::Error>> cached = plans.find(unitFrom, unitTo))
+        return *cached;
+
+    std::expected<Conversion, libuc::Error> compiled;
+    std::optional<UnitExpression> source = parseUnitExpression(*this, unitFrom);
+    std::optional<UnitExpression> target = parseUnitExpression(*this, unitTo);
+    if (!source)
+        compiled = std::unexpected(libuc::Error::UnknownFromUnit);
+    else if (!target)
+        compiled = std::unexpected(libuc::Error::UnknownToUnit);
+    else if (source->dimension != target->dimension)
+        compiled = std::unexpected(libuc::Error::IncompatibleUnits);
+    else
+        compiled = Conversion{ source->scale / target->scale, 0 };
+    plans.insert(unitFrom, unitTo, compiled);
+    return compiled;
+}
+
+
+std::expected<double, libuc::Error> Units::convert(double amount, std::string_view unitFrom,
+                                                   std::string_view unitTo) const noexcept {
+    UC_STATS_SCOPE(Stage::Convert);
+    if (memo.enabled()) {
+        UnitId from = findUnit(unitFrom);
+        UnitId to = findUnit(unitTo);
+        if (from != unknownUnit && to != unknownUnit && convertible(from, to)) {
+            if (std::optional<double> remembered = memo.find(from, to, amount))
+                return *remembered;
+            Conversion c = conversion(from, to);
+            double result = amount * c.scale + c.offset;
+            memo.insert(from, to, amount, result);
+            return result;
+        }
+    }
+
+    std::expected<Conversion, libuc::Error> c;
+    try {
+        c = plan(unitFrom, unitTo);
+    } catch (const std::exception&) {
+        return std::unexpected(libuc::Error::InvalidValue);
+    }
+    if (!c)
+        return std::unexpected(c.error());
+    return amount * c->scale + c->offset;
+}
+
+
+std::expected<ExactConversion, libuc::Error> Units::exactConversion(std::string_view unitFrom,
+                                                                    std::string_view unitTo) const noexcept {
+    UnitId from = findUnit(unitFrom);
+    UnitId to = findUnit(unitTo);
+    if (from == unknownUnit)
+        return std::unexpected(isUnitExpression(unitFrom) ? libuc::Error::NotExact : libuc::Error::UnknownFromUnit);
+    if (to == unknownUnit)
+        return std::unexpected(isUnitExpression(unitTo) ? libuc::Error::NotExact : libuc::Error::UnknownToUnit);
+    if (!convertible(from, to))
+        return std::unexpected(libuc::Error::IncompatibleUnits);
+
+    std::optional<ExactConversion> source = exactBaseConversion(table.records[from]);
+    std::optional<ExactConversion> target = exactBaseConversion(table.records[to]);
+    std::optional<ExactConversion> c = source && target ? composeExactConversion(*source, *target) : std::nullopt;
+    if (!c)
+        return std::unexpected(libuc::Error::NotExact);
+    return *c;
+}
+
+
+std::expected<Rational, libuc::Error> Units::convertExact(const Rational& amount, std::string_view unitFrom,
+                                                          std::string_view unitTo) const noexcept {
+    std::expected<ExactConversion, libuc::Error> c = exactConversion(unitFrom, unitTo);
+    if (!c)
+        return std::unexpected(c.error());
+
+    if (amount.den == 1 && c->scale.den == 1 && c->offset.num == 0) {
+        std::optional<std::int64_t> product = rational::multiply(amount.num, c->scale.num);
+        if (!product)
+            return std::unexpected(libuc::Error::NotExact);
+        return Rational{ *product, 1 };
+    }
+    std::optional<Rational> scaled = amount * c->scale;
+    std::optional<Rational> result = scaled ? *scaled + c->offset : std::nullopt;
+    if (!result)
+        return std::unexpected(libuc::Error::NotExact);
+    return *result;
+}
+
+
+std::expected<long double, libuc::Error> Units::convertExtended(long double amount, std::string_view unitFrom,
+                                                                std::string_view unitTo) const noexcept {
+    std::expected<ExactConversion, libuc::Error> exact = exactConversion(unitFrom, unitTo);
+    if (exact)
+        return amount * toLongDouble(exact->scale) + toLongDouble(exact->offset);
+    if (exact.error() != libuc::Error::NotExact)
+        return std::unexpected(exact.error());
+
+    std::expected<Conversion, libuc::Error> c;
+    try {
+        c = plan(unitFrom, unitTo);
+    } catch (const std::exception&) {
+        return std::unexpected(libuc::Error::InvalidValue);
+    }
+    if (!c)
+        return std::unexpected(c.error());
+    return amount * c->scale + c->offset;
+}
+
+
+double Units::convertValue(double amount, std::string_view unitFrom, std::string_view unitTo) const {
+    std::expected<double, libuc::Error> result = convert(amount, unitFrom, unitTo);
+    if (result)
+        return *result;
+    switch (result.error()) {
+        case libuc::Error::UnknownFromUnit:
+            throw std::invalid_argument("Unknown unit: " + std::string(unitFrom));
+        case libuc::Error::UnknownToUnit:
+            throw std::invalid_argument("Unknown unit: " + std::string(unitTo));
+        default:
+            throw std::invalid_argument("Cannot convert between: " + std::string(unitFrom) + " and " + std::string(unitTo));
+    }
+}
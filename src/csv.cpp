@@ -0,0 +1,166 @@
+// csv.cpp: Conversion of selected columns of CSV and TSV text
+#include <algorithm>
+#include <charconv>
+#include <format>
+#include <iostream>
+#include <stdexcept>
+#include <system_error>
+
+#include "csv.hpp"
+#include "simd.hpp"
+
+
+CsvColumn parseCsvColumn(const Units& u, std::string_view spec) {
+    std::size_t first = spec.find(':');
+    std::size_t second = first == std::string_view::npos ? first : spec.find(':', first + 1);
+    if (second == std::string_view::npos || second + 1 == spec.size())
+        throw std::invalid_argument("Expected <column>:<from_unit>:<to_unit>, not " + std::string(spec) + ".");
+
+    std::string_view number = spec.substr(0, first);
+    std::size_t column = 0;
+    auto [ptr, ec] = std::from_chars(number.data(), number.data() + number.size(), column);
+    if (ec != std::errc() || ptr != number.data() + number.size() || column == 0)
+        throw std::invalid_argument(std::string(number) + " is not a valid column; columns are counted from 1.");
+
+    return { column - 1, resolvePair(u, spec.substr(first + 1, second - first - 1), spec.substr(second + 1)) };
+}
+
+
+CsvConverter::CsvConverter(std::vector<CsvColumn> columns, char delimiter, bool header, const NumberFormat& format)
+    : columns(std::move(columns)), delimiter(delimiter), header(header), format(format) {
+    if (this->columns.empty())
+        throw std::invalid_argument("No column to convert.");
+    std::sort(this->columns.begin(), this->columns.end(),
+              [](const CsvColumn& a, const CsvColumn& b) { return a.index < b.index; });
+    auto repeated = std::adjacent_find(this->columns.begin(), this->columns.end(),
+                                       [](const CsvColumn& a, const CsvColumn& b) { return a.index == b.index; });
+    if (repeated != this->columns.end())
+        throw std::invalid_argument(std::format("Column {} is given more than once.", repeated->index + 1));
+}
+
+
+std::size_t CsvConverter::convert(std::string_view text, bool last, std::string& out, std::string& errors) {
+    const char* const end = text.data() + text.size();
+    ByteScanner scanner(text, delimiter, '\n', '"');
+    // Input before written is in out; input before record is used
+    const char* written = text.data();
+    const char* record = text.data();
+
+    while (record < end) {
+        // Undone if the record turns out to be incomplete
+        const std::size_t outSize = out.size();
+        const std::size_t errorsSize = errors.size();
+        const std::size_t failedBefore = failed;
+        const char* writtenBefore = written;
+
+        const bool converting = !header || records > 0;
+        ++records;
+        std::size_t column = 0;
+        auto wanted = columns.begin();
+        const char* field = record;
+        const char* recordEnd = nullptr;
+        while (recordEnd == nullptr) {
+            // The field's value, and where the field stops: at a delimiter, newline or the end
+            const char* valueStart = field;
+            const char* valueEnd = nullptr;
+            const char* stop = field;
+            if (field < end && *field == '"') {
+                valueStart = field + 1;
+                valueEnd = end;
+                stop = end;
+                for (const char* quote = scanner.next(valueStart); quote < end;) {
+                    if (*quote != '"')
+                        quote = scanner.next(quote + 1);
+                    else if (quote + 1 < end && quote[1] == '"')
+                        quote = scanner.next(quote + 2);
+                    else {
+                        valueEnd = quote;
+                        stop = quote + 1;
+                        break;
+                    }
+                }
+            }
+            // Past an unquoted value's start, or a closing quote, a quote is text
+            while (stop < end && (stop = scanner.next(stop)) < end && *stop == '"')
+                ++stop;
+            if (valueEnd == nullptr)
+                valueEnd = stop;
+            // A closing quote at the end may be the first of a "", and a field at the end
+            // may go on in the next block
+            const bool complete = last || stop < end;
+            if (!complete) {
+                out.resize(outSize);
+                errors.resize(errorsSize);
+                failed = failedBefore;
+                written = writtenBefore;
+                --records;
+                out.append(written, record);
+                return static_cast<std::size_t>(record - text.data());
+            }
+
+            // A \r before the newline stays outside the value
+            const char* replaced = stop;
+            if ((stop == end || *stop == '\n') && replaced > field && replaced[-1] == '\r') {
+                --replaced;
+                if (valueEnd > replaced)
+                    valueEnd = replaced;
+            }
+
+            if (converting && wanted != columns.end() && wanted->index == column) {
+                std::string_view value(valueStart, static_cast<std::size_t>(valueEnd - valueStart));
+                std::size_t first = value.find_first_not_of(' ');
+                value = first == std::string_view::npos ? std::string_view() : value.substr(first, value.find_last_not_of(' ') - first + 1);
+                double amount;
+                if (value.empty()) {
+                    // Passed through
+                } else if (parseNumber(value, amount)) {
+                    out.append(written, field);
+                    appendNumber(out, amount * wanted->pair.conversion.scale + wanted->pair.conversion.offset, format);
+                    written = replaced;
+                } else {
+                    errors += std::format("Row {}, column {}: {} is not a valid number.\n", records, column + 1, value);
+                    ++failed;
+                }
+                ++wanted;
+            }
+
+            if (stop == end)
+                recordEnd = end;
+            else if (*stop == '\n')
+                recordEnd = stop + 1;
+            else {
+                field = stop + 1;
+                ++column;
+            }
+        }
+        record = recordEnd;
+    }
+    out.append(written, end);
+    return text.size();
+}
+
+
+std::size_t convertCsv(std::istream& in, std::ostream& out, CsvConverter& converter) {
+    const std::size_t blockSize = 1 << 20;
+    std::string input, output, errors;
+    for (;;) {
+        // Records cut by the end of a block are kept for the next
+        std::size_t kept = input.size();
+        input.resize(kept + blockSize);
+        in.read(input.data() + kept, static_cast<std::streamsize>(blockSize));
+        input.resize(kept + static_cast<std::size_t>(in.gcount()));
+        const bool last = !in;
+
+        std::size_t used = converter.convert(input, last, output, errors);
+        out.write(output.data(), static_cast<std::streamsize>(output.size()));
+        if (!errors.empty())
+            std::cerr << errors;
+        output.clear();
+        errors.clear();
+        input.erase(0, used);
+        if (last)
+            break;
+    }
+    out.flush();
+    return converter.failures();
+}
@@ -0,0 +1,151 @@
+// expressions.cpp: Parsing and reduction of compound unit expressions
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <system_error>
+
+#include "expressions.hpp"
+
+
+namespace {
+    // Categories that are powers of another, with the size of their base unit in that
+    // category's base unit: a Liter is 0.001 cubic meters
+    struct DerivedCategory {
+        std::string_view category;
+        std::string_view base;
+        int exponent;
+        double scale;
+    };
+
+    constexpr DerivedCategory derivedCategories[] = {
+        { "AREA", "DISTANCE", 2, 1.0 },
+        { "VOLUME", "DISTANCE", 3, 0.001 },
+    };
+
+
+    void multiply(UnitExpression& into, const UnitExpression& by, int power) {
+        into.scale *= std::pow(by.scale, power);
+        for (auto [category, exponent]: by.dimension) {
+            auto at = std::lower_bound(into.dimension.begin(), into.dimension.end(), category,
+                                       [](const auto& term, std::string_view key) { return term.first < key; });
+            if (at != into.dimension.end() && at->first == category)
+                at->second += exponent * power;
+            else
+                at = into.dimension.insert(at, { category, exponent * power });
+            if (at->second == 0)
+                into.dimension.erase(at);
+        }
+    }
+
+
+    // Recursive descent over: product = power (('*' | '/') power)*,
+    // power = primary ('^' integer)?, primary = '(' product ')' | unit
+    class Parser {
+        private:
+            const Units& u;
+            std::string_view text;
+            std::size_t at = 0;
+
+            void skipSpaces() {
+                while (at < text.size() && text[at] == ' ')
+                    ++at;
+            }
+
+            bool accept(char ch) {
+                skipSpaces();
+                if (at < text.size() && text[at] == ch) {
+                    ++at;
+                    return true;
+                }
+                return false;
+            }
+
+            std::optional<UnitExpression> unit() {
+                skipSpaces();
+                std::size_t start = at;
+                while (at < text.size() && std::string_view("*/^()").find(text[at]) == std::string_view::npos)
+                    ++at;
+                std::string_view name = text.substr(start, at - start);
+                name = name.substr(0, name.find_last_not_of(' ') + 1);
+                UnitExpression expression;
+                auto [end, ec] = std::from_chars(name.data(), name.data() + name.size(), expression.scale);
+                if (!name.empty() && ec == std::errc() && end == name.data() + name.size())
+                    return expression.scale > 0 ? std::optional(expression) : std::nullopt;
+
+                UnitId id = u.findUnit(name);
+                if (name.empty() || id == unknownUnit)
+                    return std::nullopt;
+                const UnitRecord& record = u.units()[id];
+                expression.scale = baseConversion(record).scale;
+                for (const DerivedCategory& derived: derivedCategories) {
+                    if (record.category == derived.category) {
+                        expression.scale *= derived.scale;
+                        expression.dimension.push_back({ derived.base, derived.exponent });
+                        return expression;
+                    }
+                }
+                expression.dimension.push_back({ record.category, 1 });
+                return expression;
+            }
+
+            std::optional<UnitExpression> primary() {
+                if (!accept('('))
+                    return unit();
+                std::optional<UnitExpression> inner = product();
+                if (!inner || !accept(')'))
+                    return std::nullopt;
+                return inner;
+            }
+
+            std::optional<UnitExpression> power() {
+                std::optional<UnitExpression> base = primary();
+                if (!base || !accept('^'))
+                    return base;
+                skipSpaces();
+                int exponent;
+                auto [end, ec] = std::from_chars(text.data() + at, text.data() + text.size(), exponent);
+                if (ec != std::errc() || exponent < -64 || exponent > 64)
+                    return std::nullopt;
+                at = static_cast<std::size_t>(end - text.data());
+                UnitExpression raised;
+                multiply(raised, *base, exponent);
+                return raised;
+            }
+
+            std::optional<UnitExpression> product() {
+                std::optional<UnitExpression> result = power();
+                while (result) {
+                    bool divide = accept('/');
+                    if (!divide && !accept('*'))
+                        break;
+                    std::optional<UnitExpression> factor = power();
+                    if (!factor)
+                        return std::nullopt;
+                    multiply(*result, *factor, divide ? -1 : 1);
+                }
+                return result;
+            }
+
+        public:
+            Parser(const Units& u, std::string_view text) : u(u), text(text) {}
+
+            std::optional<UnitExpression> parse() {
+                std::optional<UnitExpression> result = product();
+                skipSpaces();
+                if (at != text.size())
+                    return std::nullopt;
+                return result;
+            }
+    };
+}
+
+
+bool isUnitExpression(std::string_view text) noexcept {
+    return text.find_first_of("*/^()") != std::string_view::npos;
+}
+
+
+std::optional<UnitExpression> parseUnitExpression(const Units& u, std::string_view text) {
+    UC_STATS_SCOPE(Stage::Parse);
+    return Parser(u, text).parse();
+}
@@ -0,0 +1,299 @@
+// formula.cpp: Compilation and evaluation of formulas over constants
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <format>
+#include <string>
+#include <system_error>
+#include <utility>
+
+#include "batch.hpp"
+#include "formula.hpp"
+
+
+namespace {
+    using Op = Formula::Op;
+    using Instruction = Formula::Instruction;
+
+    // Deepest nesting of parentheses and signs, which bounds the parser's recursion
+    constexpr int maxNesting = 256;
+
+
+    double apply(Op op, double left, double right) noexcept {
+        switch (op) {
+            case Op::Add: return left + right;
+            case Op::Subtract: return left - right;
+            case Op::Multiply: return left * right;
+            case Op::Divide: return left / right;
+            case Op::Power: return std::pow(left, right);
+            default: return right;
+        }
+    }
+
+
+    // Recursive descent over: sum = product (('+' | '-') product)*,
+    // product = unary (('*' | '/') unary)*, unary = ('-' | '+') unary | power,
+    // power = primary ('^' unary)?, primary = '(' sum ')' | number | name | '{' name '}'.
+    // Each rule emits the code of its operand and returns whether that code is a single
+    // Push, which the rules above fold into their own operations.
+    class Compiler {
+        private:
+            const Constants& c;
+            std::string_view text;
+            std::size_t at = 0;
+            int nesting = 0;
+            std::vector<Instruction>& code;
+            bool& input;
+            // Values on the stack after the code so far
+            std::size_t depth = 0;
+
+            [[noreturn]] void fail() const {
+                throw FormulaError(std::format("Invalid expression at column {}: {}", at + 1, text));
+            }
+
+            void skipSpaces() {
+                while (at < text.size() && text[at] == ' ')
+                    ++at;
+            }
+
+            bool accept(char ch) {
+                skipSpaces();
+                if (at < text.size() && text[at] == ch) {
+                    ++at;
+                    return true;
+                }
+                return false;
+            }
+
+            void push(Instruction instruction) {
+                code.push_back(instruction);
+                if (instruction.op == Op::Push || instruction.op == Op::Input) {
+                    if (++depth > Formula::maxDepth)
+                        throw FormulaError(std::format("Expression too complex: {}", text));
+                } else if (instruction.op != Op::Negate && !instruction.immediate) {
+                    --depth;
+                }
+            }
+
+            // Emits op over the operands whose code starts at left and right, the last two
+            // on the stack
+            void binary(Op op, std::size_t left, bool leftConstant, bool rightConstant) {
+                const std::size_t right = code.size() - 1;
+                if (leftConstant && rightConstant) {
+                    code[left].value = apply(op, code[left].value, code[right].value);
+                    code.pop_back();
+                    --depth;
+                } else if (rightConstant) {
+                    double value = code[right].value;
+                    code.pop_back();
+                    --depth;
+                    push({ op, true, value });
+                } else if (leftConstant && (op == Op::Add || op == Op::Multiply)) {
+                    double value = code[left].value;
+                    code.erase(code.begin() + static_cast<std::ptrdiff_t>(left));
+                    --depth;
+                    push({ op, true, value });
+                } else {
+                    push({ op });
+                }
+            }
+
+            bool constant(std::string_view name) {
+                name = name.substr(0, name.find_last_not_of(' ') + 1);
+                if (name.empty())
+                    fail();
+                const ConstantRecord* record = c.findConstant(name);
+                if (record == nullptr)
+                    throw FormulaError(std::format("{}: {}", libuc::errorMessage(libuc::Error::UnknownConstant), name), name);
+                double value = c.value(static_cast<UnitId>(record - c.constants().data()));
+                if (std::isnan(value))
+                    throw FormulaError(std::format("{}: {} is {}", libuc::errorMessage(libuc::Error::InvalidValue), name, record->value));
+                push({ Op::Push, false, value });
+                return true;
+            }
+
+            bool primary() {
+                skipSpaces();
+                if (accept('(')) {
+                    bool folded = sum();
+                    if (!accept(')'))
+                        fail();
+                    return folded;
+                }
+                if (accept('{')) {
+                    std::size_t close = text.find('}', at);
+                    if (close == std::string_view::npos)
+                        fail();
+                    std::string_view name = text.substr(at, close - at);
+                    at = close + 1;
+                    return constant(name.substr(std::min(name.find_first_not_of(' '), name.size())));
+                }
+                if (at < text.size() && ((text[at] >= '0' && text[at] <= '9') || text[at] == '.')) {
+                    double value;
+                    auto [end, ec] = std::from_chars(text.data() + at, text.data() + text.size(), value);
+                    if (ec != std::errc())
+                        fail();
+                    at = static_cast<std::size_t>(end - text.data());
+                    push({ Op::Push, false, value });
+                    return true;
+                }
+                // Names run to the next operator, and may hold spaces
+                std::size_t start = at;
+                while (at < text.size() && std::string_view("+-*/^(){}").find(text[at]) == std::string_view::npos)
+                    ++at;
+                std::string_view name = text.substr(start, at - start);
+                if (name.substr(0, name.find_last_not_of(' ') + 1) == "x") {
+                    input = true;
+                    push({ Op::Input });
+                    return false;
+                }
+                return constant(name);
+            }
+
+            bool power() {
+                std::size_t left = code.size();
+                bool leftConstant = primary();
+                if (!accept('^'))
+                    return leftConstant;
+                bool rightConstant = unary();
+                binary(Op::Power, left, leftConstant, rightConstant);
+                return leftConstant && rightConstant;
+            }
+
+            bool unary() {
+                if (++nesting > maxNesting)
+                    fail();
+                bool negate = accept('-');
+                bool folded = negate || accept('+') ? unary() : power();
+                if (negate && folded)
+                    code.back().value = -code.back().value;
+                else if (negate)
+                    push({ Op::Negate });
+                --nesting;
+                return folded;
+            }
+
+            bool product() {
+                std::size_t left = code.size();
+                bool folded = unary();
+                for (;;) {
+                    bool divide = accept('/');
+                    if (!divide && !accept('*'))
+                        return folded;
+                    bool rightConstant = unary();
+                    binary(divide ? Op::Divide : Op::Multiply, left, folded, rightConstant);
+                    folded = folded && rightConstant;
+                }
+            }
+
+            bool sum() {
+                if (++nesting > maxNesting)
+                    fail();
+                std::size_t left = code.size();
+                bool folded = product();
+                for (;;) {
+                    bool subtract = accept('-');
+                    if (!subtract && !accept('+'))
+                        break;
+                    bool rightConstant = product();
+                    binary(subtract ? Op::Subtract : Op::Add, left, folded, rightConstant);
+                    folded = folded && rightConstant;
+                }
+                --nesting;
+                return folded;
+            }
+
+        public:
+            Compiler(const Constants& c, std::string_view text, std::vector<Instruction>& code, bool& input)
+                : c(c), text(text), code(code), input(input) {}
+
+            void compile() {
+                sum();
+                skipSpaces();
+                if (at != text.size())
+                    fail();
+            }
+
+            // Appends result * scale + offset, folded into the last instruction where it can be
+            void convert(Conversion conversion) {
+                for (auto [op, value]: { std::pair(Op::Multiply, conversion.scale), std::pair(Op::Add, conversion.offset) }) {
+                    if (value == (op == Op::Multiply ? 1.0 : 0.0))
+                        continue;
+                    if (code.size() == 1 && code.back().op == Op::Push)
+                        code.back().value = apply(op, code.back().value, value);
+                    else
+                        push({ op, true, value });
+                }
+            }
+    };
+}
+
+
+double Formula::evaluate(double x) const noexcept {
+    std::array<double, maxDepth> stack;
+    std::size_t top = 0;
+    for (const Instruction& instruction: code) {
+        switch (instruction.op) {
+            case Op::Push:
+                stack[top++] = instruction.value;
+                break;
+            case Op::Input:
+                stack[top++] = x;
+                break;
+            case Op::Negate:
+                stack[top - 1] = -stack[top - 1];
+                break;
+            default: {
+                double right = instruction.immediate ? instruction.value : stack[--top];
+                stack[top - 1] = apply(instruction.op, stack[top - 1], right);
+                break;
+            }
+        }
+    }
+    return stack[0];
+}
+
+
+Formula compileFormula(const Units& u, const Constants& c, std::string_view text, std::string_view unitFrom,
+                       std::string_view unitTo) {
+    UC_STATS_SCOPE(Stage::Parse);
+    Formula formula;
+    Compiler compiler(c, text, formula.code, formula.input);
+    compiler.compile();
+    if (!unitFrom.empty() || !unitTo.empty()) {
+        try {
+            compiler.convert(resolvePair(u, unitFrom, unitTo).conversion);
+        } catch (const std::invalid_argument& e) {
+            throw FormulaError(e.what());
+        }
+    }
+    return formula;
+}
+
+
+std::size_t evaluateLines(std::istream& in, std::ostream& out, std::ostream& errors, const Formula& formula,
+                          const NumberFormat& format) {
+    OutputBuffer output(out, format);
+    std::size_t lineNumber = 0;
+    std::size_t failures = 0;
+    std::string line;
+    std::vector<std::string_view> fields;
+    while (std::getline(in, line)) {
+        ++lineNumber;
+        splitFields(line, fields);
+        if (fields.empty())
+            continue;
+        double x;
+        if (fields.size() != 1 || !parseNumber(fields.front(), x)) {
+            std::string_view value = fields.size() == 1 ? fields.front() : std::string_view(line);
+            errors << "Line " << lineNumber << ": " << value << " is not a valid number." << '\n';
+            ++failures;
+            continue;
+        }
+        output << formula.evaluate(x) << '\n';
+    }
+    output.flush();
+    out.flush();
+    return failures;
+}
@@ -0,0 +1,206 @@
+// search.cpp: Prefix and nearest-key search over unit and constant names
+#include <algorithm>
+#include <cstdint>
+#include <span>
+#include <tuple>
+
+#include "search.hpp"
+
+
+namespace {
+    // Longer words are not compared, which bounds the edit distance rows
+    constexpr std::size_t maxWordLength = 64;
+
+
+    std::string fold(std::string_view text) {
+        std::string folded(text);
+        for (char& c: folded)
+            c = foldChar(c);
+        return folded;
+    }
+}
+
+
+SearchIndex::SearchIndex(const Units& u) {
+    addUnits(u);
+    build();
+}
+
+
+SearchIndex::SearchIndex(const Constants& c) {
+    addConstants(c);
+    build();
+}
+
+
+SearchIndex::SearchIndex(const Units& u, const Constants& c) {
+    addUnits(u);
+    addConstants(c);
+    build();
+}
+
+
+void SearchIndex::add(std::string_view key, SearchKind kind, UnitId record) {
+    if (key.empty())
+        return;
+    entries.push_back({ static_cast<std::uint32_t>(folded.size()), static_cast<std::uint32_t>(key.size()), key, kind, record });
+    for (char c: key)
+        folded.push_back(foldChar(c));
+}
+
+
+void SearchIndex::addUnits(const Units& u) {
+    std::span<const UnitRecord> units = u.units();
+    std::span<const std::uint32_t> categoryOf = u.unitFactors().categoryOf;
+    // Categories are numbered in order of first appearance, so each is added once
+    std::uint32_t categories = 0;
+    for (UnitId id = 0; id < units.size(); ++id) {
+        add(units[id].symbol, SearchKind::Unit, id);
+        add(units[id].name, SearchKind::Unit, id);
+        if (categoryOf[id] == categories) {
+            ++categories;
+            add(units[id].category, SearchKind::Category, unknownUnit);
+        }
+    }
+}
+
+
+void SearchIndex::addConstants(const Constants& c) {
+    std::span<const ConstantRecord> constants = c.constants();
+    std::span<const std::uint32_t> groupOf = c.groupIds();
+    std::uint32_t groups = 0;
+    for (UnitId id = 0; id < constants.size(); ++id) {
+        // Constants without a symbol have - in its place
+        if (constants[id].symbol != "-")
+            add(constants[id].symbol, SearchKind::Constant, id);
+        add(constants[id].name, SearchKind::Constant, id);
+        if (groupOf[id] == groups) {
+            ++groups;
+            add(constants[id].group, SearchKind::Group, unknownUnit);
+        }
+    }
+}
+
+
+void SearchIndex::build() {
+    // Ties in the folded key, rare but for categories and groups, which may repeat
+    auto rest = [](const Entry& e) { return std::tie(e.kind, e.key, e.record); };
+    std::sort(entries.begin(), entries.end(), [&](const Entry& a, const Entry& b) {
+        int order = foldedKey(a).compare(foldedKey(b));
+        return order != 0 ? order < 0 : rest(a) < rest(b);
+    });
+    entries.erase(std::unique(entries.begin(), entries.end(), [&](const Entry& a, const Entry& b) {
+        return foldedKey(a) == foldedKey(b) && rest(a) == rest(b);
+    }), entries.end());
+}
+
+
+std::vector<std::string_view> SearchIndex::complete(std::string_view prefix, SearchKind kind, std::size_t limit) const {
+    const std::string prefixFolded = fold(prefix);
+    std::vector<std::string_view> keys;
+    auto at = std::lower_bound(entries.begin(), entries.end(), prefixFolded,
+                               [&](const Entry& e, std::string_view key) { return foldedKey(e) < key; });
+    for (; at != entries.end() && foldedKey(*at).starts_with(prefixFolded); ++at) {
+        // Keys shared by several records are next to each other
+        if (at->kind != kind || (!keys.empty() && keys.back() == at->key))
+            continue;
+        keys.push_back(at->key);
+        if (keys.size() == limit)
+            break;
+    }
+    return keys;
+}
+
+
+std::vector<std::string_view> SearchIndex::suggest(std::string_view word, SearchKind kind, std::size_t limit) const {
+    const std::string target = fold(word);
+    if (target.empty() || target.size() > maxWordLength || limit == 0)
+        return {};
+    const std::size_t bound = target.size() <= 4 ? 1 : 2;
+    const std::size_t columns = target.size() + 1;
+
+    // rows[d] holds the distances from each prefix of the word to the first d characters
+    // of the current key, counting a swap of adjacent characters as one edit, or beyond
+    // when more than bound. Only the band of prefixes within bound of d characters long
+    // is computed; the rest stay beyond. No key deeper than the word's length plus bound
+    // can be within bound, so neither can rows.
+    const std::uint8_t beyond = static_cast<std::uint8_t>(bound + 1);
+    std::vector<std::uint8_t> rows((target.size() + bound + 2) * columns, beyond);
+    for (std::size_t j = 0; j <= bound && j < columns; ++j)
+        rows[j] = static_cast<std::uint8_t>(j);
+    for (std::size_t d = 1; d <= bound; ++d)
+        rows[d * columns] = static_cast<std::uint8_t>(d);
+
+    // By distance, then by difference in length, then in key order
+    std::vector<std::tuple<std::uint8_t, std::size_t, std::size_t>> near;
+    std::string_view previous;
+    for (std::size_t i = 0; i < entries.size();) {
+        const std::string_view key = foldedKey(entries[i]);
+        std::size_t depth = 0;
+        while (depth < previous.size() && depth < key.size() && previous[depth] == key[depth])
+            ++depth;
+
+        bool pruned = false;
+        for (std::size_t d = depth + 1; d <= key.size(); ++d) {
+            std::uint8_t* row = &rows[d * columns];
+            const std::uint8_t* above = row - columns;
+            std::uint8_t rowMinimum = row[0];
+            for (std::size_t j = d > bound ? d - bound : 1; j < columns && j <= d + bound; ++j) {
+                unsigned distance = std::min({ above[j] + 1u, row[j - 1] + 1u, above[j - 1] + (key[d - 1] == target[j - 1] ? 0u : 1u) });
+                if (d > 1 && j > 1 && key[d - 1] == target[j - 2] && key[d - 2] == target[j - 1])
+                    distance = std::min(distance, above[j - 2 - columns] + 1u);
+                row[j] = static_cast<std::uint8_t>(std::min(distance, unsigned(beyond)));
+                rowMinimum = std::min(rowMinimum, row[j]);
+            }
+            if (rowMinimum > bound) {
+                // Skip every key starting with this prefix, often none but this one
+                std::string_view prefix = key.substr(0, d);
+                auto under = [&](const Entry& e) { return foldedKey(e).starts_with(prefix); };
+                if (++i < entries.size() && under(entries[i]))
+                    i = static_cast<std::size_t>(std::partition_point(entries.begin() + static_cast<std::ptrdiff_t>(i), entries.end(), under)
+                                                 - entries.begin());
+                previous = prefix.substr(0, d - 1);
+                pruned = true;
+                break;
+            }
+        }
+        if (pruned)
+            continue;
+
+        std::uint8_t distance = rows[key.size() * columns + target.size()];
+        if (entries[i].kind == kind && distance <= bound) {
+            std::size_t lengthDifference = key.size() > target.size() ? key.size() - target.size() : target.size() - key.size();
+            near.emplace_back(distance, lengthDifference, i);
+        }
+        previous = key;
+        ++i;
+    }
+    std::sort(near.begin(), near.end());
+
+    std::vector<std::string_view> keys;
+    std::vector<UnitId> records;
+    for (auto [distance, lengthDifference, i]: near) {
+        const Entry& entry = entries[i];
+        if (std::find(keys.begin(), keys.end(), entry.key) != keys.end()
+            || (entry.record != unknownUnit && std::find(records.begin(), records.end(), entry.record) != records.end()))
+            continue;
+        keys.push_back(entry.key);
+        records.push_back(entry.record);
+        if (keys.size() == limit)
+            break;
+    }
+    return keys;
+}
+
+
+std::string didYouMean(const std::vector<std::string_view>& suggestions) {
+    if (suggestions.empty())
+        return "";
+    std::string text = ". Did you mean ";
+    for (std::size_t i = 0; i < suggestions.size(); ++i) {
+        if (i > 0)
+            text += i + 1 == suggestions.size() ? " or " : ", ";
+        text += suggestions[i];
+    }
+    return text + "?";
+}
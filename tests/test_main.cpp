@@ -1,15 +1,69 @@
 // test_main.cpp: Contains all the tests for the unit converter application
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
 #include <cstring>
+#include <expected>
+#include <filesystem>
 #include <format>
+#include <fstream>
+#include <limits>
+#include <new>
+#include <optional>
+#include <span>
+#include <sstream>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
 #include <gtest/gtest.h>
 
-// Include the functions/file to test
-#include "../src/main.cpp"
+// Include the library and command line under test
+#include "catalogue.hpp"
+#include "cli.hpp"
+#include "history_index.hpp"
+#include "libuc.hpp"
+#include "unix_socket.hpp"
+
+// Counts heap allocations, so tests can check that library calls make none. The
+// replacements pair malloc with free, which GCC takes for a mismatch.
+static std::atomic<std::size_t> allocations = 0;
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+
+void* operator new(std::size_t size) {
+    ++allocations;
+    if (void* memory = std::malloc(size == 0 ? 1 : size))
+        return memory;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void* memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
+#pragma GCC diagnostic pop
 
 // Test cases
 static std::unordered_map<std::string, std::vector<std::vector<std::string>>> test_cases =
@@ -37,11 +91,37 @@ static std::unordered_map<std::string, std::vector<std::vector<std::string>>> te
     {"ConvertUnitVolume",                     {{ "uc", "5", "l", "gal" },                          { "1.3209" }}},
     {"ConvertUnitArea",                       {{ "uc", "100", "m^2", "ft^2" },                     { "1076.3915" }}},
     {"ConvertUnitData",                       {{ "uc", "1", "GB", "MB" },                          { "1000.0000" }}},
+    {"ConvertUnitNameCaseAgnostic",           {{ "uc", "1", "KILOGRAM", "gram" },                  { "1000.0000" }}},
+    {"ConvertUnitTemperatureByName",          {{ "uc", "100", "celsius", "fahrenheit" },           { "212.0000" }}},
     {"ConvertUnitInvalidValue",               {{ "uc", "invalid", "m", "ft" },                     { "Invalid argument: invalid is not a valid number.", "Usage: uc" }}},
     {"ConvertUnitOutOfRangeValue",            {{ "uc", "1e1000", "m", "ft" },                      { "Out of range: 1e1000 is too large or too small.", "Usage: uc" }}},
     {"ConvertUnitUnknownFromUnit",            {{ "uc", "10", "unknown", "ft" },                    { "Unknown unit: unknown" }}},
     {"ConvertUnitUnknownToUnit",              {{ "uc", "10", "m", "unknown" },                     { "Unknown unit: unknown" }}},
     {"ConvertUnitIncompatibleUnits",          {{ "uc", "10", "m", "g" },                           { "Cannot convert between: m and g" }}},
+    {"ConvertExactData",                      {{ "uc", "--exact", "1.5", "GiB", "MB" },            { "1610.612736" }}},
+    {"ConvertExactRepeating",                 {{ "uc", "--exact", "100", "F", "C" },               { "37.77777777777777777778" }}},
+    {"ConvertExactFraction",                  {{ "uc", "--exact", "1/3", "m", "cm" },              { "Invalid argument: 1/3 is not a valid number.", "Usage: uc" }}},
+    {"ConvertExactTrailingText",              {{ "uc", "--exact", "1abc", "m", "cm" },             { "Invalid argument: 1abc is not a valid number.", "Usage: uc" }}},
+    {"ConvertExactTooManyDigits",             {{ "uc", "--exact", "99999999999999999999", "m", "ft" }, { "Out of range: 99999999999999999999 has too many digits or is too large." }}},
+    {"ConvertExtendedFurlong",                {{ "uc", "--extended", "1", "fur", "m" },            { "201.68" }}},
+    {"ConvertPrecision",                      {{ "uc", "--precision", "2", "10", "m", "ft" },      { "32.81" }}},
+    {"ConvertScientific",                     {{ "uc", "--scientific", "10", "m", "ft" },          { "3.2808e+01" }}},
+    {"ConvertShortest",                       {{ "uc", "--shortest", "10", "m", "ft" },            { "32.80839895013123" }}},
+    {"ConvertPrecisionInvalid",               {{ "uc", "--precision", "99", "10", "m", "ft" },     { "Invalid argument: 99 is not a precision from 0 to 50.", "Usage: uc" }}},
+    {"ConvertStats",                          {{ "uc", "--stats", "10", "m", "ft" },               { "32.8084" }}},
+    {"ConvertUnknownSuggestion",              {{ "uc", "10", "kmm", "ft" },                        { "Unknown unit: kmm. Did you mean km or mm?" }}},
+    {"ConvertUnknownSuggestionName",          {{ "uc", "10", "m", "Kilometr" },                    { "Unknown unit: Kilometr. Did you mean Kilometer?" }}},
+    {"ListUnitsUnknownSuggestion",            {{ "uc", "-u", "distanse" },                         { "Unknown category: distanse. Did you mean DISTANCE?" }}},
+    {"ConstantUnknownSuggestion",             {{ "uc", "Golden Ration" },                          { "Unknown constant: Golden Ration. Did you mean Golden Ratio?" }}},
+    {"CompleteUnits",                         {{ "uc", "--complete", "units", "kilo" },            { "Kilobit\nKilobyte\nKilogram\nKilometer\n" }}},
+    {"CompleteGroups",                        {{ "uc", "--complete", "groups" },                   { "CHEMISTRY\nMATHEMATICS\nPHYSICS\n" }}},
+    {"CompleteMissingArg",                    {{ "uc", "--complete" },                             { "Missing argument for --complete option.", "Usage: uc" }}},
+    {"CompleteInvalidKind",                   {{ "uc", "--complete", "unit", "k" },                { "Invalid argument: unit is not units, categories, constants or groups.", "Usage: uc" }}},
+    {"ConvertExpressionSpeed",                {{ "uc", "36", "km/h", "m/s" },                      { "10.0000" }}},
+    {"ConvertExpressionDataRate",             {{ "uc", "1", "MB/s", "Mbit/s" },                    { "8.0000" }}},
+    {"ConvertExpressionGrouped",              {{ "uc", "5", "l/(100*km)", "gal/mi" },              { "0.0213" }}},
+    {"ConvertExpressionIncompatible",         {{ "uc", "1", "km/h", "kg" },                        { "Cannot convert between: km/h and kg" }}},
+    {"ConvertExpressionMalformed",            {{ "uc", "1", "km/", "m" },                          { "Unknown unit: km/" }}},
     {"ListConstantsGroupsUnknownOption",      {{ "uc", "-Cg", "unknown" },                         { "Unknown option: unknown", "Usage: uc" }}},
     {"ListConstantsOptionMissingArg",         {{ "uc", "-C" },                                     { "Missing argument for -C option.", "Usage: uc" }}},
     {"ListConstantsOptionUnknownGroup",       {{ "uc", "-C", "unknown" },                          { "Unknown group: unknown" }}},
@@ -49,8 +129,38 @@ static std::unordered_map<std::string, std::vector<std::vector<std::string>>> te
     {"ListConstantsDetailedOptionUnknownArg", {{ "uc", "-Cd", "unknown" },                         { "Unknown option: unknown", "Usage: uc" }}},
     {"GetConstantValue",                      {{ "uc", """Speed of Light in Vacuum""" },           { "299792458" }}},
     {"GetConstantValueSymbol",                {{ "uc", "c" },                                      { "299792458" }}},
+    {"GetConstantValueNameCaseAgnostic",      {{ "uc", "golden ratio" },                           { "1.618033988749895" }}},
+    {"GetConstantValueSharedSymbol",          {{ "uc", "e" },                                      { "2.718281828459045" }}},
     {"GetConstantValueUnknown",               {{ "uc", "unknown" },                                { "Unknown constant: unknown" }}},
     {"GetConstantValueExtraArg",              {{ "uc", "c", "extra" },                             { "Unknown or incomplete option.", "Usage: uc" }}},
+    {"HistoryInvalidCount",                   {{ "uc", "--hist", "many" },                         { "Invalid argument: many is not a valid number of entries.", "Usage: uc" }}},
+    {"HistorySearchMissingArg",               {{ "uc", "--hist-search" },                          { "Missing argument for --hist-search option.", "Usage: uc" }}},
+    {"HistoryRangeInvalidTime",               {{ "uc", "--hist-range", "yesterday" },              { "Invalid time: yesterday", "Usage: uc" }}},
+    {"ServeMissingArg",                       {{ "uc", "--serve" },                                { "Missing argument for --serve option.", "Usage: uc" }}},
+    {"ClientNoServer",                        {{ "uc", "--client", "/nonexistent/uc.sock", "pi" }, { "Unable to connect to /nonexistent/uc.sock" }}},
+    {"UnitsFileMissingArg",                   {{ "uc", "--units-file" },                           { "Missing argument for --units-file option.", "Usage: uc" }}},
+    {"UnitsFileUnreadable",                   {{ "uc", "--units-file", "/nonexistent.dat", "1", "m", "ft" }, { "Unable to open file: /nonexistent.dat" }}},
+    {"BatchMissingFile",                      {{ "uc", "--batch", "missing.txt" },                 { "Unable to open file: missing.txt" }}},
+    {"BatchExtraArg",                         {{ "uc", "--batch", "m", "ft", "in.txt", "extra" },  { "Unknown option: extra", "Usage: uc" }}},
+    {"BatchIncompatibleUnits",                {{ "uc", "--batch", "m", "g" },                      { "Cannot convert between: m and g" }}},
+    {"BatchJobsMissingArg",                   {{ "uc", "--batch", "--jobs" },                      { "Missing argument for --jobs option.", "Usage: uc" }}},
+    {"BatchJobsInvalidArg",                   {{ "uc", "--batch", "--jobs", "many" },              { "Invalid argument: many is not a valid number of jobs.", "Usage: uc" }}},
+    {"BatchFileMissingFile",                  {{ "uc", "--batch-file", "missing.txt" },            { "Unable to open file: missing.txt" }}},
+    {"BatchFileMissingArg",                   {{ "uc", "--batch-file", "m", "ft" },                { "Missing argument for --batch-file option.", "Usage: uc" }}},
+    {"BinaryMissingUnits",                    {{ "uc", "--binary", "m" },                          { "Missing units for --binary option.", "Usage: uc" }}},
+    {"BinaryUnknownOption",                   {{ "uc", "--binary", "--f16", "m", "ft" },           { "Unknown option: --f16", "Usage: uc" }}},
+    {"CsvMissingColumn",                      {{ "uc", "--csv", "data.csv" },                      { "Missing --col option for --csv.", "Usage: uc" }}},
+    {"CsvInvalidColumn",                      {{ "uc", "--csv", "--col", "0:m:ft" },               { "0 is not a valid column; columns are counted from 1." }}},
+    {"CsvUnknownUnit",                        {{ "uc", "--csv", "--col", "2:ftt:m" },              { "Unknown unit: ftt. Did you mean fth or ft?" }}},
+    {"MemoInvalidArg",                        {{ "uc", "--memo", "lots", "10", "m", "ft" },        { "Invalid argument: lots is not a valid memo size.", "Usage: uc" }}},
+    {"MemoConvert",                           {{ "uc", "--memo", "64", "10", "m", "ft" },          { "32.8084" }}},
+    {"HistoryModeInvalidArg",                 {{ "uc", "--history-mode", "later", "10", "m", "ft" }, { "Invalid argument: later is not async, drop or sync.", "Usage: uc" }}},
+    {"HistoryModeSync",                       {{ "uc", "--history-mode", "sync", "10", "m", "ft" }, { "32.8084" }}},
+    {"EvalConstants",                         {{ "uc", "--eval", "2*pi" },                         { "6.2832" }}},
+    {"EvalConvert",                           {{ "uc", "--eval", "1/2 + 1", "m", "cm" },           { "150.0000" }}},
+    {"EvalMissingArg",                        {{ "uc", "--eval" },                                 { "Missing argument for --eval option.", "Usage: uc" }}},
+    {"EvalUnknownConstant",                   {{ "uc", "--eval", "2*pj" },                         { "Unknown constant: pj. Did you mean Pi?" }}},
+    {"EvalInvalidExpression",                 {{ "uc", "--eval", "2*" },                           { "Invalid expression at column 3: 2*" }}},
     {"UnknownOption",                         {{ "uc", "--unknown" },                              { "Unknown or incomplete option.", "Usage: uc" }}},
     {"IncompleteOption",                      {{ "uc", "-" },                                      { "Unknown or incomplete option.", "Usage: uc" }}}
 };
@@ -125,6 +235,988 @@ TEST(UnitsTest, AllTestCases)
     }
 }
 
+TEST(UnitsTest, BatchConversion)
+{
+    Units U;
+    U.loadUnits(listOfUnits);
+
+    std::istringstream lines("10 m ft\n\n100 C F\n2 fl oz ml\nx m ft\n10 m g\n");
+    std::ostringstream results;
+    EXPECT_EQ(convertBatch(lines, results, U), 2u);
+    EXPECT_EQ(results.str(), "32.8084\n212.0000\n59.1470\n");
+
+    std::istringstream column("1\n2.5\n");
+    std::ostringstream columnResults;
+    EXPECT_EQ(convertBatch(column, columnResults, U, "kg", "g"), 0u);
+    EXPECT_EQ(columnResults.str(), "1000.0000\n2500.0000\n");
+}
+
+TEST(UnitsTest, ParallelBatchKeepsOrder)
+{
+    Units U;
+    U.loadUnits(builtinUnits, builtinFactors);
+
+    // Enough lines for several 1 MiB blocks, with an invalid line in the middle
+    std::string input;
+    for (int i = 0; i < 200000; ++i)
+        input += i == 123456 ? "bad m ft\n" : std::format("{} m ft\n", i);
+
+    std::istringstream sequentialIn(input), parallelIn(input);
+    std::ostringstream sequentialOut, parallelOut;
+    EXPECT_EQ(convertBatch(sequentialIn, sequentialOut, U), 1u);
+    EXPECT_EQ(convertBatch(parallelIn, parallelOut, U, "", "", 4), 1u);
+    EXPECT_EQ(parallelOut.str(), sequentialOut.str());
+
+    std::istringstream column("1\n2\n3");
+    std::ostringstream columnOut;
+    EXPECT_EQ(convertBatch(column, columnOut, U, "km", "m", 3), 0u);
+    EXPECT_EQ(columnOut.str(), "1000.0000\n2000.0000\n3000.0000\n");
+
+    // A line longer than a block is converted whole
+    std::istringstream longLine("1\n" + std::string(3 << 20, '0') + "2\n3\n");
+    std::ostringstream longOut;
+    EXPECT_EQ(convertBatch(longLine, longOut, U, "km", "m", 2), 0u);
+    EXPECT_EQ(longOut.str(), "1000.0000\n2000.0000\n3000.0000\n");
+}
+
+TEST(UnitsTest, MappedFileMatchesStream)
+{
+    Units U;
+    U.loadUnits(builtinUnits, builtinFactors);
+
+    std::string input;
+    for (int i = 0; i < 50000; ++i)
+        input += i % 1000 == 7 ? "1 m kg\n" : std::format("{}.5 {}\n", i, i % 2 ? "ft m" : "F C");
+    input += "2 fl oz ml";
+
+    std::filesystem::path inputPath = std::filesystem::temp_directory_path() / "uc_test_input.txt";
+    std::filesystem::path outputPath = std::filesystem::temp_directory_path() / "uc_test_output.txt";
+    std::ofstream(inputPath, std::ios::binary) << input;
+
+    std::istringstream in(input);
+    std::ostringstream expected;
+    std::size_t expectedFailures = convertBatch(in, expected, U);
+
+    for (unsigned jobs: { 1u, 3u }) {
+        int fd = open(outputPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+        ASSERT_GE(fd, 0);
+        EXPECT_EQ(convertMappedFile(inputPath, fd, U, "", "", jobs), expectedFailures);
+        close(fd);
+
+        std::ifstream output(outputPath, std::ios::binary);
+        std::string actual((std::istreambuf_iterator<char>(output)), std::istreambuf_iterator<char>());
+        EXPECT_EQ(actual, expected.str());
+    }
+
+    std::filesystem::remove(inputPath);
+    std::filesystem::remove(outputPath);
+}
+
+TEST(UnitsTest, BinaryColumns)
+{
+    Units U;
+    U.loadUnits(builtinUnits, builtinFactors);
+    std::filesystem::path inputPath = std::filesystem::temp_directory_path() / "uc_test_input.bin";
+    std::filesystem::path outputPath = std::filesystem::temp_directory_path() / "uc_test_output.bin";
+
+    // Writes bytes to the input file, converts it and returns the output bytes
+    auto run = [&](const std::string& bytes, const std::string& from, const std::string& to, std::size_t width, bool header) {
+        std::ofstream(inputPath, std::ios::binary) << bytes;
+        int in = open(inputPath.c_str(), O_RDONLY);
+        int out = open(outputPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+        try {
+            convertBinary(in, out, U, from, to, width, header);
+        } catch (...) {
+            close(in);
+            close(out);
+            throw;
+        }
+        close(in);
+        close(out);
+        std::ifstream output(outputPath, std::ios::binary);
+        return std::string((std::istreambuf_iterator<char>(output)), std::istreambuf_iterator<char>());
+    };
+
+    std::vector<double> values(100003);
+    for (std::size_t i = 0; i < values.size(); ++i)
+        values[i] = static_cast<double>(i) * 0.5;
+    std::string bytes(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(double));
+
+    std::string output = run(bytes, "C", "F", 8, false);
+    ASSERT_EQ(output.size(), bytes.size());
+    std::vector<double> results(values.size());
+    std::memcpy(results.data(), output.data(), output.size());
+    for (std::size_t i = 0; i < values.size(); ++i)
+        ASSERT_EQ(results[i], U.convertValue(values[i], "C", "F"));
+
+    float singles[] = { 1.0f, 2.5f, -3.0f };
+    output = run(std::string(reinterpret_cast<const char*>(singles), sizeof(singles)), "km", "m", 4, false);
+    ASSERT_EQ(output.size(), sizeof(singles));
+    std::memcpy(singles, output.data(), sizeof(singles));
+    EXPECT_EQ(singles[0], 1000.0f);
+    EXPECT_EQ(singles[1], 2500.0f);
+    EXPECT_EQ(singles[2], -3000.0f);
+
+    BinaryHeader header;
+    std::memcpy(header.from, "kg", 2);
+    std::memcpy(header.to, "g", 1);
+    double two = 2.0;
+    output = run(std::string(reinterpret_cast<const char*>(&header), sizeof(header)) + std::string(reinterpret_cast<const char*>(&two), 8), "", "", 8, true);
+    ASSERT_EQ(output.size(), sizeof(header) + 8);
+    std::memcpy(&header, output.data(), sizeof(header));
+    std::memcpy(&two, output.data() + sizeof(header), 8);
+    EXPECT_STREQ(header.from, "g");
+    EXPECT_EQ(two, 2000.0);
+
+    EXPECT_THROW(run(bytes.substr(0, 12), "m", "ft", 8, false), std::invalid_argument);
+    EXPECT_THROW(run(bytes, "m", "g", 8, false), std::invalid_argument);
+    EXPECT_THROW(run("not a header", "", "m", 8, true), std::invalid_argument);
+
+    std::filesystem::remove(inputPath);
+    std::filesystem::remove(outputPath);
+}
+
+TEST(UnitsTest, CatalogueFiles)
+{
+    std::filesystem::path directory = std::filesystem::temp_directory_path() / "uc_test_catalogue";
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(directory / "site");
+    auto write = [](const std::filesystem::path& path, const std::string& text) {
+        std::ofstream(path, std::ios::trunc) << text;
+    };
+    // A new unit, and a foot that overrides the built-in one
+    write(directory / "site" / "units.dat",
+          "DISTANCE    Chain               ch      Meter          20.1168\n"
+          "DISTANCE    Foot                ft      Meter          0.3\n");
+    write(directory / "site" / "constants.dat",
+          "PHYSICS         Site Gravity                   g           9.81                m/s^2\n");
+
+    CatalogueFiles files = catalogueFiles(std::string("/nonexistent:") + (directory / "site").string() + ":");
+    ASSERT_EQ(files.units.size(), 2u);
+    ASSERT_EQ(files.constants.size(), 1u);
+    files.units.erase(files.units.begin());
+
+    // Parsed and snapshotted, then loaded from the snapshot, with the same results
+    const std::filesystem::path cache = directory / "cache";
+    for (bool fromSnapshot: { false, true }) {
+        Units U;
+        Constants C;
+        EXPECT_EQ(loadCatalogue(U, C, files, cache), fromSnapshot);
+        EXPECT_DOUBLE_EQ(*U.convert(1, "ch", "m"), 20.1168);
+        EXPECT_DOUBLE_EQ(*U.convert(1, "ft", "m"), 0.3);
+        EXPECT_DOUBLE_EQ(*U.convert(100, "C", "F"), 212.0);
+        EXPECT_EQ(U.convert(1, "ch", "kg").error(), libuc::Error::IncompatibleUnits);
+        EXPECT_EQ(U.units().size(), builtinUnitRecords.size() + 2);
+        EXPECT_DOUBLE_EQ(*C.value("g"), 9.81);
+        EXPECT_DOUBLE_EQ(*C.value("pi"), 3.141592653589793);
+    }
+
+    // A changed file makes the snapshot stale
+    write(directory / "site" / "units.dat", "DISTANCE    Chain               ch      Meter          20\n");
+    std::filesystem::last_write_time(directory / "site" / "units.dat",
+                                     std::filesystem::last_write_time(directory / "site" / "units.dat") + std::chrono::seconds(5));
+    Units U;
+    Constants C;
+    EXPECT_FALSE(loadCatalogue(U, C, files, cache));
+    EXPECT_DOUBLE_EQ(*U.convert(1, "ch", "m"), 20.0);
+    EXPECT_NEAR(*U.convert(1, "ft", "m"), 0.3048, 1e-12);
+
+    // Unreadable files and malformed tables leave the tables as they were
+    files.units.push_back((directory / "missing.dat").string());
+    EXPECT_THROW(loadCatalogue(U, C, files, cache), std::runtime_error);
+    files.units.back() = (directory / "bad.dat").string();
+    write(files.units.back(), "DISTANCE    Bad                 bad     Meter          x\n");
+    EXPECT_THROW(loadCatalogue(U, C, files, ""), std::runtime_error);
+    EXPECT_DOUBLE_EQ(*U.convert(1, "ch", "m"), 20.0);
+    std::filesystem::remove_all(directory);
+}
+
+TEST(UnitsTest, HistoryAppends)
+{
+    std::filesystem::path path = std::filesystem::temp_directory_path() / "uc_test_history";
+    std::filesystem::remove(path);
+    History history(path);
+
+    // Concurrent appends are numbered without gaps or repeats
+    std::vector<std::thread> writers;
+    for (int t = 0; t < 4; ++t)
+        writers.emplace_back([&history]() {
+            for (int i = 0; i < 200; ++i)
+                history.append(1, "m", "ft", 3.28084);
+        });
+    for (std::thread& writer: writers)
+        writer.join();
+
+    // A batch is appended as one group, continuing from the last index
+    Units U;
+    U.loadUnits(builtinUnits, builtinFactors);
+    std::istringstream in("1 km m\n2\n");
+    std::ostringstream out;
+    EXPECT_EQ(convertBatch(in, out, U, "", "", 1, &history), 1u);
+    std::istringstream column("1\n2\n");
+    EXPECT_EQ(convertBatch(column, out, U, "km", "m", 2, &history), 0u);
+
+    std::ifstream file(path);
+    std::string line;
+    std::size_t count = 0;
+    while (std::getline(file, line)) {
+        ++count;
+        EXPECT_EQ(line.substr(0, line.find(' ')), std::to_string(count));
+        if (count == 801) {
+            EXPECT_EQ(line, "801  uc 1 km m 1000");
+        }
+        if (count == 803) {
+            EXPECT_EQ(line, "803  uc 2 km m 2000");
+        }
+    }
+    EXPECT_EQ(count, 803u);
+    std::filesystem::remove(path);
+}
+
+TEST(UnitsTest, HistoryWriteBehind)
+{
+    std::filesystem::path path = std::filesystem::temp_directory_path() / "uc_test_history_behind";
+    std::filesystem::remove(path);
+    std::filesystem::remove(HistoryIndex::pathFor(path));
+
+    // Appends from several threads through a queue smaller than they fill, so that some
+    // wait for the writer, are all written, numbered in order, by the time tail reads them
+    {
+        History history(path);
+        history.writeBehind(4);
+        std::vector<std::thread> writers;
+        for (int t = 0; t < 4; ++t)
+            writers.emplace_back([&history]() {
+                for (int i = 0; i < 250; ++i)
+                    history.append(1, "m", "ft", 3.28084);
+            });
+        for (std::thread& writer: writers)
+            writer.join();
+        history.flush();
+        std::ifstream file(path);
+        EXPECT_EQ(std::count(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>(), '\n'), 1000);
+
+        // Destroying the history writes what is still queued
+        history.append(2, "km", "m", 2000);
+    }
+    std::ifstream file(path);
+    std::string line, last;
+    std::size_t count = 0;
+    while (std::getline(file, line)) {
+        ++count;
+        EXPECT_EQ(line.substr(0, line.find(' ')), std::to_string(count));
+        last = line;
+    }
+    EXPECT_EQ(count, 1001u);
+    EXPECT_EQ(last, "1001 uc 2 km m 2000");
+
+    // A full queue drops batches rather than waiting, and counts their records
+    std::atomic<bool> release = false;
+    std::atomic<int> batches = 0;
+    std::string written;
+    std::vector<HistoryWriter::Stamp> stamps;
+    {
+        HistoryWriter writer(2, HistoryOverflow::Drop, [&](std::string_view records, std::span<const HistoryWriter::Stamp> times) {
+            release.wait(false);
+            for (HistoryWriter::Stamp stamp: times)
+                stamps.push_back({ written.size() + stamp.end, stamp.time });
+            written += records;
+            ++batches;
+        });
+        int accepted = 0;
+        for (int i = 0; i < 6; ++i)
+            accepted += writer.push("a\tb\tc\td\n", 100 + i) ? 1 : 0;
+        EXPECT_GE(accepted, 2);
+        EXPECT_LE(accepted, 3);
+        EXPECT_EQ(writer.dropped(), static_cast<std::uint64_t>(6 - accepted));
+        release = true;
+        release.notify_all();
+        writer.flush();
+        EXPECT_EQ(written.size(), static_cast<std::size_t>(accepted) * 8);
+    }
+    // Each batch keeps the time it was pushed with, not the time it was written
+    ASSERT_EQ(stamps.size(), written.size() / 8);
+    for (std::size_t i = 0; i < stamps.size(); ++i) {
+        EXPECT_EQ(stamps[i].end, (i + 1) * 8);
+        EXPECT_EQ(stamps[i].time, 100 + static_cast<std::int64_t>(i));
+    }
+    EXPECT_LE(batches.load(), 2);
+    std::filesystem::remove(path);
+    std::filesystem::remove(HistoryIndex::pathFor(path));
+}
+
+TEST(UnitsTest, HistoryQueries)
+{
+    std::filesystem::path path = std::filesystem::temp_directory_path() / "uc_test_history_queries";
+    std::filesystem::remove(path);
+    std::filesystem::remove(HistoryIndex::pathFor(path));
+    History history(path);
+
+    std::string records;
+    for (int i = 0; i < 1000; ++i)
+        History::record(records, i, i % 10 == 0 ? "fl oz" : "m", i % 10 == 0 ? "ml" : "ft", i);
+    history.append(records);
+
+    auto output = [](auto query) {
+        testing::internal::CaptureStdout();
+        query();
+        return testing::internal::GetCapturedStdout();
+    };
+    EXPECT_EQ(output([&]() { history.tail(2); }), "999  uc 998 m ft 998\n1000 uc 999 m ft 999\n");
+
+    std::string search = output([&]() { history.search("fl oz"); });
+    EXPECT_EQ(std::count(search.begin(), search.end(), '\n'), 100);
+    EXPECT_EQ(search.substr(0, search.find('\n')), "1    uc 0 fl oz ml 0");
+    EXPECT_EQ(output([&]() { history.search("oz"); }), "No matching history entries found.\n");
+
+    std::string recent = output([&]() { history.range(*History::parseTime("1h"), INT64_MAX); });
+    EXPECT_EQ(std::count(recent.begin(), recent.end(), '\n'), 1000);
+    EXPECT_EQ(output([&]() { history.range(0, *History::parseTime("2000-01-01")); }), "No matching history entries found.\n");
+    EXPECT_FALSE(History::parseTime("2000-01-01T10"));
+    EXPECT_EQ(History::parseTime("86400"), 86400);
+
+    // Compaction keeps the last entries and their index
+    output([&]() { history.compact(15); });
+    EXPECT_EQ(output([&]() { history.search("ml"); }), "991  uc 990 fl oz ml 990\n");
+    history.append(1, "m", "ft", 3.28084);
+    EXPECT_EQ(output([&]() { history.tail(1); }), "1001 uc 1 m ft 3.28084\n");
+
+    // A missing index is rebuilt from the history file
+    std::string feet = output([&]() { history.search("ft"); });
+    EXPECT_EQ(std::count(feet.begin(), feet.end(), '\n'), 15);
+    std::filesystem::remove(HistoryIndex::pathFor(path));
+    EXPECT_EQ(output([&]() { history.search("ft"); }), feet);
+
+    // Clearing empties the history and its index
+    EXPECT_EQ(output([&]() { history.clear(); }), "Conversion history cleared.\n");
+    EXPECT_EQ(std::filesystem::file_size(path), 0u);
+    EXPECT_EQ(output([&]() { history.search("ft"); }), "No matching history entries found.\n");
+    history.append(1, "m", "ft", 3.28084);
+    EXPECT_EQ(output([&]() { history.tail(5); }), "1    uc 1 m ft 3.28084\n");
+
+    std::filesystem::remove(path);
+    std::filesystem::remove(HistoryIndex::pathFor(path));
+}
+
+TEST(UnitsTest, ServerAnswersPipelinedRequests)
+{
+    Units U;
+    Constants C;
+    U.loadUnits(builtinUnits, builtinFactors);
+    C.loadConstants(builtinConstants);
+
+    std::string path = (std::filesystem::temp_directory_path() / "uc_test.sock").string();
+    std::filesystem::remove(path);
+    // A stale socket is replaced, but not one a server is listening on
+    {
+        int stale = socket(AF_UNIX, SOCK_STREAM, 0);
+        sockaddr_un address = unix_socket::address(path);
+        ASSERT_EQ(bind(stale, reinterpret_cast<sockaddr*>(&address), sizeof(address)), 0);
+        close(stale);
+    }
+    UnixServer server(path);
+    EXPECT_THROW(UnixServer second(path), std::runtime_error);
+    std::thread serving([&]() {
+        server.run([&](std::string_view request, std::string& response) { return serveRequest(request, U, C, response); });
+    });
+
+    std::vector<std::pair<bool, std::string>> answers;
+    {
+        UnixClient client(path);
+        std::string requests = "10 m ft\n2 fl oz ml\npi\n1 m kg\n--clrhist\n-Cg\n";
+        for (int i = 0; i < 20000; ++i)
+            requests += std::format("{} km m\n", i);
+        client.exchange(requests, [&](bool ok, std::string_view payload) { answers.emplace_back(ok, payload); });
+
+        std::string response;
+        EXPECT_TRUE(client.request("Speed of Light in Vacuum", response));
+        EXPECT_EQ(response, "299792458\n");
+    }
+
+    // The client's exit status says whether any request failed
+    for (auto [request, status]: { std::pair("1 m ft", EXIT_SUCCESS), std::pair("1 m kg", EXIT_FAILURE) }) {
+        auto argv = create_argv({ "uc", "--client", path, request });
+        testing::internal::CaptureStdout();
+        EXPECT_EQ(uc(4, argv.data(), U, C), status) << request;
+        testing::internal::GetCapturedStdout();
+        for (char* arg: argv)
+            delete[] arg;
+    }
+    server.stop();
+    serving.join();
+
+    ASSERT_EQ(answers.size(), 20006u);
+    EXPECT_EQ(answers[0], std::make_pair(true, std::string("32.8084\n")));
+    EXPECT_EQ(answers[1], std::make_pair(true, std::string("59.1470\n")));
+    EXPECT_EQ(answers[2], std::make_pair(true, std::string("3.141592653589793\n")));
+    EXPECT_EQ(answers[3], std::make_pair(false, std::string("Cannot convert between: m and kg")));
+    EXPECT_EQ(answers[4], std::make_pair(false, std::string("Unsupported request: --clrhist")));
+    EXPECT_EQ(answers[5].second.substr(0, 12), "MATHEMATICS\n");
+    EXPECT_EQ(answers[20005], std::make_pair(true, std::string("19999000.0000\n")));
+}
+
+TEST(UnitsTest, BuiltinTablesMatchText)
+{
+    // The compile-time parse must agree with std::stod on every factor
+    std::istringstream units{std::string(listOfUnits)};
+    std::string line;
+    std::size_t row = 0;
+    while (std::getline(units, line)) {
+        ASSERT_LT(row, builtinUnitRecords.size());
+        EXPECT_EQ(builtinUnitRecords[row].symbol, field(line, 32, 8));
+        EXPECT_EQ(builtinUnitRecords[row].conversionFactor, std::stod(line.substr(55)));
+        ++row;
+    }
+    EXPECT_EQ(row, builtinUnitRecords.size());
+    EXPECT_EQ(builtinConstantRecords.size(), countRows(listOfConstants));
+
+    // Each index holds one slot per distinct key; the rest must read as empty
+    auto occupied = [](std::span<const IndexSlot> slots) {
+        return std::count_if(slots.begin(), slots.end(), [](const IndexSlot& slot) { return slot.id != unknownUnit; });
+    };
+    EXPECT_EQ(occupied(builtinUnitSymbols), static_cast<long>(builtinUnitRecords.size()));
+    EXPECT_EQ(occupied(builtinUnitNames), static_cast<long>(builtinUnitRecords.size()));
+
+    Units U;
+    U.loadUnits(builtinUnits, builtinFactors);
+    EXPECT_EQ(U.findUnit("ft"), 25u);
+    EXPECT_EQ(U.findUnit("FOOT"), 25u);
+    EXPECT_EQ(U.findUnit("unknown"), unknownUnit);
+}
+
+TEST(UnitsTest, FactorMatrix)
+{
+    // The compile-time matrix and one built from parsed text must agree
+    Units builtin, parsed;
+    builtin.loadUnits(builtinUnits, builtinFactors);
+    parsed.loadUnits(listOfUnits);
+
+    for (UnitId from = 0; from < builtinUnitRecords.size(); ++from) {
+        for (UnitId to = 0; to < builtinUnitRecords.size(); ++to) {
+            ASSERT_EQ(builtin.convertible(from, to), parsed.convertible(from, to));
+            ASSERT_EQ(builtin.convertible(from, to), builtinUnitRecords[from].category == builtinUnitRecords[to].category);
+            if (builtin.convertible(from, to)) {
+                EXPECT_EQ(builtin.conversion(from, to).scale, parsed.conversion(from, to).scale);
+                EXPECT_EQ(builtin.conversion(from, to).offset, parsed.conversion(from, to).offset);
+            }
+        }
+    }
+
+    Conversion ftToM = builtin.conversion(builtin.findUnit("ft"), builtin.findUnit("m"));
+    EXPECT_DOUBLE_EQ(ftToM.scale, 0.3048);
+    EXPECT_EQ(ftToM.offset, 0.0);
+    Conversion cToF = builtin.conversion(builtin.findUnit("C"), builtin.findUnit("F"));
+    EXPECT_DOUBLE_EQ(cToF.scale, 1.8);
+    EXPECT_DOUBLE_EQ(cToF.offset, 32.0);
+}
+
+TEST(UnitsTest, LibraryApi)
+{
+    // Warm the built-in tables, then check that lookups never allocate
+    EXPECT_NEAR(*libuc::convert(10, "m", "ft"), 32.8084, 1e-4);
+    EXPECT_NEAR(*libuc::constant("pi"), 3.14159, 1e-5);
+    std::size_t before = allocations;
+    std::expected<double, libuc::Error> feet = libuc::convert(10, "meter", "FOOT");
+    std::expected<double, libuc::Error> fahrenheit = libuc::convert(100, "C", "F");
+    std::expected<double, libuc::Error> unknown = libuc::convert(1, "parsec", "m");
+    std::expected<double, libuc::Error> unknownTo = libuc::convert(1, "m", "parsec");
+    std::expected<double, libuc::Error> incompatible = libuc::convert(1, "m", "kg");
+    std::expected<double, libuc::Error> light = libuc::constant("c");
+    std::expected<double, libuc::Error> golden = libuc::constant("golden ratio");
+    std::expected<double, libuc::Error> missing = libuc::constant("unknown");
+    EXPECT_EQ(allocations - before, 0u);
+
+    EXPECT_NEAR(*feet, 32.8084, 1e-4);
+    EXPECT_DOUBLE_EQ(*fahrenheit, 212.0);
+    EXPECT_EQ(unknown.error(), libuc::Error::UnknownFromUnit);
+    EXPECT_EQ(unknownTo.error(), libuc::Error::UnknownToUnit);
+    EXPECT_EQ(incompatible.error(), libuc::Error::IncompatibleUnits);
+    EXPECT_EQ(*light, 299792458.0);
+    EXPECT_DOUBLE_EQ(*golden, 1.618033988749895);
+    EXPECT_EQ(missing.error(), libuc::Error::UnknownConstant);
+    EXPECT_EQ(libuc::errorMessage(libuc::Error::IncompatibleUnits), "Incompatible units");
+}
+
+TEST(UnitsTest, ConvertSpan)
+{
+    Units U;
+    U.loadUnits(builtinUnits, builtinFactors);
+
+    // An odd length exercises the vector loops and their scalar tails
+    std::vector<double> in(1003);
+    for (std::size_t i = 0; i < in.size(); ++i)
+        in[i] = static_cast<double>(i) * 1.25 - 300.0;
+    std::vector<double> out(in.size());
+
+    for (auto [from, to]: std::vector<std::pair<std::string, std::string>>{ { "km", "mi" }, { "C", "F" }, { "F", "K" }, { "GiB", "MB" } }) {
+        U.convertSpan(in, out, U.findUnit(from), U.findUnit(to));
+        for (std::size_t i = 0; i < in.size(); ++i)
+            ASSERT_EQ(out[i], U.convertValue(in[i], from, to)) << from << " to " << to << " at " << i;
+    }
+
+    EXPECT_THROW(U.convertSpan(in, out, U.findUnit("m"), U.findUnit("g")), std::invalid_argument);
+    EXPECT_THROW(U.convertSpan(in, std::span<double>(out).first(10), U.findUnit("m"), U.findUnit("ft")), std::invalid_argument);
+}
+
+TEST(UnitsTest, Expressions)
+{
+    Units U;
+    U.loadUnits(builtinUnits, builtinFactors);
+
+    std::optional<UnitExpression> force = parseUnitExpression(U, "kg * m / s^2");
+    ASSERT_TRUE(force.has_value());
+    EXPECT_DOUBLE_EQ(force->scale, 1.0);
+    EXPECT_EQ(force->dimension, (std::vector<std::pair<std::string_view, int>>{ { "DISTANCE", 1 }, { "MASS", 1 }, { "TIME", -2 } }));
+    EXPECT_TRUE(parseUnitExpression(U, "m/m")->dimension.empty());
+    EXPECT_FALSE(parseUnitExpression(U, "(m/s").has_value());
+    EXPECT_FALSE(parseUnitExpression(U, "m^x").has_value());
+    EXPECT_FALSE(parseUnitExpression(U, "m*parsec").has_value());
+
+    EXPECT_DOUBLE_EQ(*U.convert(1, "kg*m/s^2", "g*cm/s^2"), 1e5);
+    EXPECT_DOUBLE_EQ(*U.convert(1, "m*m*m", "l"), 1000.0);
+    EXPECT_DOUBLE_EQ(*U.convert(1, "ha", "m*m"), 10000.0);
+    EXPECT_DOUBLE_EQ(*U.convert(2, "1/s", "1/min"), 120.0);
+    // Temperatures in expressions are intervals
+    EXPECT_DOUBLE_EQ(*U.convert(10, "C/s", "F/s"), 18.0);
+    EXPECT_EQ(U.convert(1, "km/h", "kg").error(), libuc::Error::IncompatibleUnits);
+    EXPECT_EQ(U.convert(1, "km/", "m").error(), libuc::Error::UnknownFromUnit);
+    EXPECT_EQ(U.convert(1, "m/s", "parsec/s").error(), libuc::Error::UnknownToUnit);
+
+    // Plans compile once, errors included; pairs of plain units are not cached
+    Units cached;
+    cached.loadUnits(builtinUnits, builtinFactors);
+    cached.convert(1, "km/h", "m/s");
+    cached.convert(1, "km/h", "kg");
+    cached.convert(1, "m", "ft");
+    std::size_t before = allocations;
+    EXPECT_NEAR(*cached.convert(1, "km/h", "m/s"), 1 / 3.6, 1e-15);
+    EXPECT_EQ(cached.convert(1, "km/h", "kg").error(), libuc::Error::IncompatibleUnits);
+    EXPECT_EQ(allocations - before, 0u);
+
+    // Least recently used plans are evicted first
+    PlanCache<int> plans(2);
+    plans.insert("a", "b", 1);
+    plans.insert("c", "d", 2);
+    EXPECT_EQ(plans.find("a", "b"), 1);
+    plans.insert("e", "f", 3);
+    EXPECT_EQ(plans.size(), 2u);
+    EXPECT_FALSE(plans.find("c", "d").has_value());
+    EXPECT_EQ(plans.find("e", "f"), 3);
+
+    // A fixed batch pair may be an expression
+    std::istringstream in("36\n72\n");
+    std::ostringstream out;
+    convertBatch(in, out, U, "km/h", "m/s", 1);
+    EXPECT_EQ(out.str(), "10.0000\n20.0000\n");
+}
+
+TEST(UnitsTest, ExactArithmetic)
+{
+    static_assert(parseRational("201.68") == Rational{ 5042, 25 });
+    static_assert(parseRational("6.67430e-11") == Rational{ 66743, 1000000000000000 });
+    static_assert(!parseRational("99999999999999999999").has_value());
+    static_assert(!parseRational("1.2.3").has_value());
+    static_assert(*(Rational{ 1, 3 } + Rational{ 1, 6 }) == Rational{ 1, 2 });
+    static_assert(*(Rational{ -2, 3 } / Rational{ -4, 9 }) == Rational{ 3, 2 });
+    static_assert(!(Rational{ INT64_MAX, 1 } * Rational{ 2, 1 }).has_value());
+    EXPECT_EQ(formatRational({ 1, 8 }), "0.125");
+    EXPECT_EQ(formatRational({ -2, 3 }, 4), "-0.6667");
+    EXPECT_EQ(formatRational({ 2, 3 }, 0), "1");
+
+    Units U;
+    U.loadUnits(builtinUnits, builtinFactors);
+
+    // Every data conversion of a whole number of bits is exact
+    for (const UnitRecord& from: U.units()) {
+        for (const UnitRecord& to: U.units()) {
+            if (from.category != "DATA" || to.category != "DATA")
+                continue;
+            std::expected<Rational, libuc::Error> result = U.convertExact({ 12345, 1 }, from.symbol, to.symbol);
+            ASSERT_TRUE(result.has_value()) << from.symbol << " to " << to.symbol;
+            EXPECT_EQ(*(*result * to.exactFactor), *(Rational{ 12345, 1 } * from.exactFactor)) << from.symbol << " to " << to.symbol;
+        }
+    }
+    EXPECT_EQ(*U.convertExact({ 3, 2 }, "GiB", "MB"), parseRational("1610.612736"));
+    EXPECT_EQ(*U.convertExact({ 100, 1 }, "F", "C"), (Rational{ 340, 9 }));
+    EXPECT_EQ(*U.convertExact({ -40, 1 }, "C", "F"), (Rational{ -40, 1 }));
+    EXPECT_EQ(U.convertExact({ 1, 1 }, "km/h", "m/s").error(), libuc::Error::NotExact);
+    EXPECT_EQ(U.convertExact({ INT64_MAX / 2, 1 }, "TiB", "b").error(), libuc::Error::NotExact);
+    EXPECT_EQ(U.convertExact({ 1, 1 }, "m", "kg").error(), libuc::Error::IncompatibleUnits);
+    EXPECT_EQ(U.convertExact({ 1, 1 }, "parsec", "m").error(), libuc::Error::UnknownFromUnit);
+
+    EXPECT_NEAR(static_cast<double>(*U.convertExtended(1, "fur", "m")), 201.68, 1e-12);
+    EXPECT_NEAR(static_cast<double>(*U.convertExtended(36, "km/h", "m/s")), 10.0, 1e-12);
+    EXPECT_EQ(U.convertExtended(1, "m", "kg").error(), libuc::Error::IncompatibleUnits);
+}
+
+TEST(UnitsTest, NumberFormatting)
+{
+    std::string text;
+    appendNumber(text, 32.80839895013123);
+    text += ' ';
+    appendNumber(text, 32.80839895013123, { NumberStyle::Scientific, 2 });
+    text += ' ';
+    appendNumber(text, 32.80839895013123, { NumberStyle::General, 6 });
+    text += ' ';
+    appendNumber(text, 0.1, { NumberStyle::Shortest });
+    text += ' ';
+    appendNumber(text, -1e300, { NumberStyle::Fixed, 0 });
+    EXPECT_TRUE(text.starts_with("32.8084 3.28e+01 32.8084 0.1 -1000000"));
+    EXPECT_EQ(text.size(), std::string_view("32.8084 3.28e+01 32.8084 0.1 -1").size() + 300);
+
+    // The largest long double, with every decimal
+    text.clear();
+    appendNumber(text, -std::numeric_limits<long double>::max(), { NumberStyle::Fixed, maxNumberPrecision });
+    EXPECT_EQ(text.size(), std::size_t(std::numeric_limits<long double>::max_exponent10 + 3 + maxNumberPrecision));
+
+    // Written to the stream in blocks, and in full when destroyed
+    std::ostringstream out;
+    {
+        OutputBuffer buffered(out, { NumberStyle::Fixed, 1 });
+        for (int i = 0; i < 20000; ++i)
+            buffered << 0.25 << '\n';
+        EXPECT_GT(out.str().size(), 0u);
+        EXPECT_LT(out.str().size(), 20000u * 4);
+        buffered.padded("ab", 4) << "|" << '\n';
+    }
+    EXPECT_EQ(out.str().size(), 20000u * 4 + 6);
+    EXPECT_TRUE(out.str().ends_with("0.2\nab  |\n"));
+
+    // History records keep the amount exactly and six significant digits of the result
+    std::string records;
+    History::record(records, 0.1, "m", "ft", 0.328083989501);
+    EXPECT_EQ(records, "0.1\tm\tft\t0.328084\n");
+
+    Units U;
+    U.loadUnits(builtinUnits, builtinFactors);
+    std::istringstream in("1\n2\n");
+    std::ostringstream results;
+    convertBatch(in, results, U, "m", "ft", 1, nullptr, { NumberStyle::Shortest });
+    EXPECT_EQ(results.str(), "3.280839895013123\n6.561679790026246\n");
+}
+
+TEST(UnitsTest, Statistics)
+{
+    resetStats();
+    Units U;
+    U.loadUnits(builtinUnits, builtinFactors);
+    std::istringstream in("1\n2\n3\n");
+    std::ostringstream results;
+    convertBatch(in, results, U, "m", "ft", 1, nullptr);
+    EXPECT_DOUBLE_EQ(*U.convert(1, "km", "m"), 1000.0);
+
+    std::string report;
+    appendStats(report);
+    if constexpr (statsEnabled) {
+        EXPECT_TRUE(report.starts_with("stage"));
+        EXPECT_NE(report.find("\nparse "), std::string::npos);
+        EXPECT_NE(report.find("\nconvert "), std::string::npos);
+        EXPECT_NE(report.find("\nformat "), std::string::npos);
+        EXPECT_NE(report.find("\nload "), std::string::npos);
+        EXPECT_EQ(report.find("\nhistory "), std::string::npos);
+
+        resetStats();
+        report.clear();
+        appendStats(report);
+        EXPECT_EQ(std::count(report.begin(), report.end(), '\n'), 1);
+    } else {
+        EXPECT_EQ(report, "Statistics are not compiled in; build with UC_STATS=1 to enable them.\n");
+    }
+}
+
+TEST(UnitsTest, Search)
+{
+    Units U;
+    Constants C;
+    U.loadUnits(builtinUnits, builtinFactors);
+    C.loadConstants(builtinConstants);
+    SearchIndex index(U, C);
+
+    using Keys = std::vector<std::string_view>;
+    EXPECT_EQ(index.complete("squ", SearchKind::Unit, 2), Keys({ "Square centimeter", "Square foot" }));
+    EXPECT_EQ(index.complete("te", SearchKind::Category), Keys({ "TEMPERATURE" }));
+    EXPECT_EQ(index.complete("pl", SearchKind::Constant), Keys({ "Plancks Constant" }));
+    EXPECT_TRUE(index.complete("xyz", SearchKind::Unit).empty());
+    EXPECT_EQ(index.complete("", SearchKind::Group).size(), 3u);
+
+    // Substitutions, insertions, deletions and swaps, ignoring case
+    EXPECT_EQ(index.suggest("Kilometre", SearchKind::Unit, 1), Keys({ "Kilometer" }));
+    EXPECT_EQ(index.suggest("Furlon", SearchKind::Unit, 1), Keys({ "Furlong" }));
+    EXPECT_EQ(index.suggest("mk", SearchKind::Unit, 1), Keys({ "km" }));
+    EXPECT_EQ(index.suggest("MIB", SearchKind::Unit, 2), Keys({ "MiB", "Mib" }));
+    EXPECT_EQ(index.suggest("Boltzman Constant", SearchKind::Constant), Keys({ "Boltzmann Constant" }));
+    EXPECT_EQ(index.suggest("phisics", SearchKind::Group), Keys({ "PHYSICS" }));
+    EXPECT_TRUE(index.suggest("parsec", SearchKind::Unit).empty());
+    EXPECT_TRUE(index.suggest("", SearchKind::Unit).empty());
+
+    // Long words are filtered by trigram before comparing, among many keys
+    std::string table;
+    for (int i = 0; i < 5000; ++i)
+        table += std::format("{:<12}{:<20}{:<8}{:<15}{}\n", "SYNTHETIC", std::format("Synth unit {}", i),
+                             std::format("s{}", i), "Synth unit 0", 1 + i);
+    table.pop_back();
+    U.loadUnits(table);
+    SearchIndex large(U);
+    EXPECT_EQ(large.suggest("synth unit 4321x", SearchKind::Unit, 1), Keys({ "Synth unit 4321" }));
+    EXPECT_EQ(large.complete("Synth unit 499", SearchKind::Unit).size(), 11u);
+    EXPECT_EQ(didYouMean({ "km", "mm", "cm" }), ". Did you mean km, mm or cm?");
+    EXPECT_EQ(didYouMean({}), "");
+}
+
+TEST(UnitsTest, CsvColumns)
+{
+    Units U;
+    U.loadUnits(builtinUnits, builtinFactors);
+    U.loadUnits("PRESSURE    Kilopascal          kPa     Pascal         1000\n"
+                "PRESSURE    Pound per sq inch   psi     Pascal         6894.757293168\n");
+    auto columns = [&](std::initializer_list<std::string_view> specs) {
+        std::vector<CsvColumn> parsed;
+        for (std::string_view spec: specs)
+            parsed.push_back(parseCsvColumn(U, spec));
+        return parsed;
+    };
+
+    // Quoted fields, CRLF, empty and invalid fields; the header row and other columns are copied
+    std::istringstream table("station,pressure,temperature\r\n"
+                             "\"Oslo, NO\",14.7,50\r\n"
+                             "Bergen,\"29\",\r\n"
+                             "\"Say \"\"hi\"\"\",n/a,212\n"
+                             "\"Two\nlines\",0,32");
+    std::ostringstream converted;
+    CsvConverter converter(columns({ "3:F:C", "2:psi:kPa" }), ',', true);
+    EXPECT_EQ(convertCsv(table, converted, converter), 1u);
+    EXPECT_EQ(converted.str(), "station,pressure,temperature\r\n"
+                               "\"Oslo, NO\",101.3529,10.0000\r\n"
+                               "Bergen,199.9480,\r\n"
+                               "\"Say \"\"hi\"\"\",n/a,100.0000\n"
+                               "\"Two\nlines\",0.0000,0.0000");
+
+    // Records cut by the end of the text are left for the next call
+    CsvConverter tsv(columns({ "1:km:m" }), '\t');
+    std::string out, errors;
+    EXPECT_EQ(tsv.convert("1\ta\n2\t\"b", false, out, errors), 4u);
+    EXPECT_EQ(tsv.convert("2\t\"b\nc\"\n3", false, out, errors), 8u);
+    EXPECT_EQ(tsv.convert("3", true, out, errors), 1u);
+    EXPECT_EQ(out, "1000.0000\ta\n2000.0000\t\"b\nc\"\n3000.0000");
+    EXPECT_TRUE(errors.empty());
+
+    // A record longer than a block is carried whole
+    std::string wide(3 << 20, 'x');
+    std::istringstream wideIn("1," + wide + "\n2,y");
+    std::ostringstream wideOut;
+    CsvConverter first(columns({ "1:m:cm" }));
+    EXPECT_EQ(convertCsv(wideIn, wideOut, first), 0u);
+    EXPECT_EQ(wideOut.str(), "100.0000," + wide + "\n200.0000,y");
+
+    EXPECT_THROW(parseCsvColumn(U, "0:m:ft"), std::invalid_argument);
+    EXPECT_THROW(parseCsvColumn(U, "2:m"), std::invalid_argument);
+    EXPECT_THROW(parseCsvColumn(U, "2:m:g"), std::invalid_argument);
+    EXPECT_THROW(CsvConverter(columns({ "2:m:ft", "2:m:cm" })), std::invalid_argument);
+    EXPECT_THROW(CsvConverter({}), std::invalid_argument);
+}
+
+TEST(UnitsTest, ArenaTables)
+{
+    Arena arena(Arena::bytes<double>(3) + Arena::bytes<std::uint32_t>(5));
+    std::span<double> doubles = arena.allocate<double>(3);
+    std::span<std::uint32_t> ids = arena.allocate<std::uint32_t>(5);
+    EXPECT_EQ(doubles[2], 0.0);
+    EXPECT_EQ(ids[4], 0u);
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(ids.data()) % alignof(std::max_align_t), 0u);
+    EXPECT_THROW(arena.allocate<char>(1), std::bad_alloc);
+
+    // Values are parsed once into a column, and groups numbered in order of appearance
+    Constants C;
+    C.loadConstants(builtinConstants);
+    C.loadConstants("PHYSICS         Site Gravity                   g           9.81                m/s^2\n"
+                    "SITE            Site Factor                    sf          about 2             -\n");
+    std::span<const ConstantRecord> constants = C.constants();
+    ASSERT_EQ(constants.size(), builtinConstantRecords.size() + 2);
+    EXPECT_EQ(C.value(UnitId(0)), 3.141592653589793);
+    EXPECT_EQ(*C.value("g"), 9.81);
+    EXPECT_TRUE(std::isnan(C.value(UnitId(constants.size() - 1))));
+    EXPECT_EQ(C.value("sf").error(), libuc::Error::InvalidValue);
+    std::vector<std::string_view> groups = C.groups();
+    ASSERT_EQ(groups.back(), "SITE");
+    EXPECT_EQ(C.groupIds()[constants.size() - 1], groups.size() - 1);
+    for (std::size_t i = 0; i < constants.size(); ++i)
+        ASSERT_EQ(groups[C.groupIds()[i]], constants[i].group);
+
+    // Copies share the tables, which outlive the original
+    std::optional<Units> original(std::in_place);
+    original->loadUnits(builtinUnits, builtinFactors);
+    original->loadUnits("DISTANCE    Chain               ch      Meter          20.1168\n");
+    Units copy = *original;
+    original.reset();
+    EXPECT_DOUBLE_EQ(*copy.convert(1, "ch", "m"), 20.1168);
+    EXPECT_DOUBLE_EQ(*copy.convert(1, "ch", "ft"), 20.1168 / 0.3048);
+    EXPECT_EQ(copy.units().size(), builtinUnitRecords.size() + 1);
+}
+
+TEST(UnitsTest, Formulas)
+{
+    Units U;
+    Constants C;
+    U.loadUnits(builtinUnits, builtinFactors);
+    C.loadConstants(builtinConstants);
+    auto value = [&](std::string_view text) { return compileFormula(U, C, text).evaluate(); };
+
+    EXPECT_EQ(value("1 + 2 * 3"), 7.0);
+    EXPECT_EQ(value("(1 + 2) * 3"), 9.0);
+    EXPECT_EQ(value("2^3^2"), 512.0);
+    EXPECT_EQ(value("-2^2"), -4.0);
+    EXPECT_EQ(value("8 - 2 - 1"), 5.0);
+    EXPECT_EQ(value("1.5e3 / -3"), -500.0);
+    EXPECT_DOUBLE_EQ(value("2*pi*c"), 2 * 3.141592653589793 * 299792458.0);
+    EXPECT_DOUBLE_EQ(value("NA*kB"), 6.02214076e23 * 1.380649e-23);
+    EXPECT_DOUBLE_EQ(value("Speed of Light in Vacuum / 1000"), 299792.458);
+    EXPECT_DOUBLE_EQ(value("{ln(2)} * 2"), 2 * 0.6931471805599453);
+
+    // Constants fold away, leaving the arithmetic on x
+    Formula constant = compileFormula(U, C, "2*pi*c/(1 + 1)");
+    EXPECT_EQ(constant.instructions().size(), 1u);
+    EXPECT_FALSE(constant.takesInput());
+    Formula scaled = compileFormula(U, C, "2*pi*x/c");
+    EXPECT_TRUE(scaled.takesInput());
+    ASSERT_EQ(scaled.instructions().size(), 3u);
+    EXPECT_EQ(scaled.instructions()[0].op, Formula::Op::Input);
+    EXPECT_DOUBLE_EQ(scaled.evaluate(299792458.0), 2 * 3.141592653589793);
+    EXPECT_EQ(compileFormula(U, C, "1 - x").evaluate(3), -2.0);
+    EXPECT_EQ(compileFormula(U, C, "x^2 - -x").evaluate(3), 12.0);
+    EXPECT_DOUBLE_EQ(compileFormula(U, C, "x", "C", "F").evaluate(100), 212.0);
+    EXPECT_DOUBLE_EQ(compileFormula(U, C, "60 * 60", "s", "h").evaluate(), 1.0);
+    EXPECT_EQ(compileFormula(U, C, "((((x))))").instructions().size(), 1u);
+
+    // Errors name the constant that is missing
+    try {
+        compileFormula(U, C, "2 * pj");
+        FAIL();
+    } catch (const FormulaError& e) {
+        EXPECT_EQ(e.name, "pj");
+        EXPECT_STREQ(e.what(), "Unknown constant: pj");
+    }
+    for (std::string_view bad: { "", "2*", "(1 + 2", "2 pi", "{pi", "1 + * 2", "x x" })
+        EXPECT_THROW(compileFormula(U, C, bad), FormulaError) << bad;
+    EXPECT_THROW(compileFormula(U, C, "1", "m", "kg"), FormulaError);
+    EXPECT_THROW(compileFormula(U, C, std::string(1000, '(') + "1" + std::string(1000, ')')), FormulaError);
+    std::string deep = "1";
+    for (int i = 0; i < 40; ++i)
+        deep = "x + (" + deep + ")";
+    EXPECT_THROW(compileFormula(U, C, deep), FormulaError);
+
+    // Values of x read line by line, and as a daemon would be asked
+    std::istringstream in("1\n\n2.5\nabc\n");
+    std::ostringstream out, errors;
+    EXPECT_EQ(evaluateLines(in, out, errors, compileFormula(U, C, "x * 2"), { NumberStyle::Shortest }), 1u);
+    EXPECT_EQ(out.str(), "2\n5\n");
+    EXPECT_EQ(errors.str(), "Line 4: abc is not a valid number.\n");
+    std::string response;
+    EXPECT_TRUE(serveRequest("--eval 2 * pi", U, C, response));
+    EXPECT_EQ(response, "6.2832\n");
+    response.clear();
+    EXPECT_FALSE(serveRequest("--eval x", U, C, response));
+    EXPECT_EQ(response, "No value for x in: x");
+
+    // A loaded table overrides the built-in constant named Pi by the symbol pi
+    C.loadConstants("MATHEMATICS     Site Circle Ratio              pi          3                   -\n");
+    EXPECT_EQ(*C.value("pi"), 3.0);
+    EXPECT_EQ(value("pi"), 3.0);
+    EXPECT_EQ(*C.value("Pi"), 3.141592653589793);
+}
+
+TEST(UnitsTest, MemoCache)
+{
+    Units U, plain;
+    U.loadUnits(builtinUnits, builtinFactors);
+    plain.loadUnits(builtinUnits, builtinFactors);
+    EXPECT_EQ(U.memoStats().capacity, 0u);
+
+    U.memoize(1000);
+    EXPECT_EQ(U.memoStats().capacity, 1024u);
+    EXPECT_EQ(*U.convert(10, "m", "ft"), *plain.convert(10, "m", "ft"));
+    EXPECT_EQ(*U.convert(10, "Meter", "ft"), *plain.convert(10, "m", "ft"));
+    EXPECT_EQ(*U.convert(100, "C", "F"), *plain.convert(100, "C", "F"));
+    EXPECT_EQ(*U.convert(-0.0, "m", "ft"), *plain.convert(-0.0, "m", "ft"));
+    EXPECT_EQ(U.convert(1, "m", "g").error(), libuc::Error::IncompatibleUnits);
+    EXPECT_EQ(*U.convert(1, "km/h", "m/s"), 1 / 3.6);
+    EXPECT_EQ(U.memoStats().hits, 1u);
+    EXPECT_EQ(U.memoStats().misses, 3u);
+
+    // Ids change with the tables, so loading forgets every result
+    U.loadUnits("DISTANCE    Meter               m       Meter          2");
+    EXPECT_EQ(U.memoStats().hits, 0u);
+    EXPECT_DOUBLE_EQ(*U.convert(10, "m", "ft"), 2 * *plain.convert(10, "m", "ft"));
+    Units copy = U;
+    EXPECT_EQ(copy.memoStats().capacity, 1024u);
+    EXPECT_EQ(copy.memoStats().misses, 0u);
+
+    // Concurrent callers, most of them contending for the same slots, read only results
+    // their own arguments produce
+    Units shared;
+    shared.loadUnits(builtinUnits, builtinFactors);
+    shared.memoize(256);
+    std::atomic<std::size_t> wrong = 0;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; ++t) {
+        threads.emplace_back([&, t]() {
+            const char* pairs[][2] = { { "m", "ft" }, { "C", "F" }, { "kg", "lb" }, { "GiB", "MB" } };
+            for (int i = 0; i < 200000; ++i) {
+                auto [from, to] = pairs[(i + t) % 4];
+                double amount = static_cast<double>(i % 700);
+                Conversion c = shared.conversion(shared.findUnit(from), shared.findUnit(to));
+                if (*shared.convert(amount, from, to) != amount * c.scale + c.offset)
+                    ++wrong;
+            }
+        });
+    }
+    for (std::thread& thread: threads)
+        thread.join();
+    EXPECT_EQ(wrong, 0u);
+    MemoStats stats = shared.memoStats();
+    EXPECT_EQ(stats.hits + stats.misses, 1600000u);
+    EXPECT_GT(stats.hits, 0u);
+}
+
+template <class A, class B>
+concept addable = requires(A a, B b) { a + b; };
+
+TEST(UnitsTest, Quantities)
+{
+    using libuc::quantity, libuc::quantity_of, libuc::unit;
+    using metres = quantity_of<"m">;
+    using feet = quantity_of<"ft">;
+    using celsius = quantity_of<"C">;
+
+    // Conversions fold during compilation and agree with the runtime tables
+    static_assert(metres(feet(1)).count() == 0.3048);
+    static_assert(quantity_of<"Kilometer">(2).in<"m">() == 2000);
+    static_assert(std::is_same_v<metres::dimension, libuc::distance>);
+    static_assert(metres(1) + feet(1) > metres(1.3));
+    static_assert(metres(1) == quantity_of<"cm">(100));
+
+    // Different categories, and sums across offset temperature scales, do not compile
+    static_assert(std::is_convertible_v<feet, metres>);
+    static_assert(!std::is_convertible_v<quantity_of<"g">, metres>);
+    static_assert(!addable<metres, quantity_of<"g">>);
+    static_assert(!std::equality_comparable_with<metres, quantity_of<"g">>);
+    static_assert(addable<celsius, celsius>);
+    static_assert(!addable<celsius, quantity_of<"F">>);
+
+    // Integral quantities only convert through quantity_cast
+    using bytes = quantity<libuc::data, unit<"B">, long long>;
+    static_assert(!std::is_convertible_v<quantity<libuc::data, unit<"KiB">, long long>, bytes>);
+    static_assert(libuc::quantity_cast<bytes>(quantity<libuc::data, unit<"KiB">, long long>(3)).count() == 3072);
+
+    Units U;
+    U.loadUnits(builtinUnits, builtinFactors);
+    for (double amount: { -40.0, 0.0, 36.6, 100.0 }) {
+        EXPECT_EQ(celsius(amount).in<"F">(), U.convertValue(amount, "C", "F"));
+        EXPECT_EQ(celsius(amount).in<"K">(), U.convertValue(amount, "C", "K"));
+        EXPECT_EQ(quantity_of<"mi">(amount).in<"km">(), U.convertValue(amount, "mi", "km"));
+    }
+    EXPECT_EQ(quantity_of<"GiB">::symbol(), "GiB");
+}
+
 int main(int argc, char** argv) {
     auto utcNow = std::chrono::system_clock::now();
     auto localNow = utcNow - std::chrono::hours(4);